@@ -0,0 +1,1396 @@
+/*
+ * Benchmarks of the conversions, run with make bench
+ *
+ * Each case is timed with CLOCK_MONOTONIC over a fixed number of calls,
+ * split into repetitions, and reported as the median nanoseconds per call
+ * of the repetitions with their spread, allocations per call and, where the
+ * kernel allows perf events, CPU cycles per call. Allocations are counted by
+ * wrapping malloc, calloc and realloc at link time (-Wl,--wrap), so only
+ * those made by the library and this file are seen.
+ *
+ * --json writes the results to a file that a later run can read back with
+ * --compare to flag the cases that got slower or allocate more. The
+ * comparison uses the fastest repetition, which noise can only slow down.
+ *
+ * --accuracy instead checks the conversions against published reference
+ * values and measures the error and speed of each marsPrecision.
+ */
+
+#define _GNU_SOURCE
+#include <stddef.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "libmarstime.h"
+
+// timestamps cycled through by each case, a power of two
+#define SAMPLES 4096
+// most cases a baseline may hold
+#define MAXCASES 64
+// default allowed slowdown against the baseline, in percent
+#define THRESHOLD 10.0
+// default repetitions of each case, and the most allowed
+#define REPEATS 5
+#define MAXREPEATS 101
+
+////////////////////////////////////////////////////////////////////////////////
+// Measurement
+////////////////////////////////////////////////////////////////////////////////
+
+static atomic_ulong allocs;
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void *ptr, size_t size);
+
+void* __wrap_malloc(size_t size){
+  atomic_fetch_add_explicit(&allocs, 1, memory_order_relaxed);
+  return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size){
+  atomic_fetch_add_explicit(&allocs, 1, memory_order_relaxed);
+  return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void *ptr, size_t size){
+  atomic_fetch_add_explicit(&allocs, 1, memory_order_relaxed);
+  return __real_realloc(ptr, size);
+}
+
+/*
+ * Returns the current time of the monotonic clock in seconds
+ */
+static double monotonic(){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Opens a counter of the CPU cycles this thread spends in user space
+ * Returns the counter, or -1 if perf events are not available
+ */
+static int cyclesOpen(){
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.size = sizeof(attr);
+  attr.config = PERF_COUNT_HW_CPU_CYCLES;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/*
+ * Returns the cycles counted by fd since it was last reset, or -1
+ */
+static long cyclesRead(int fd){
+  uint64_t count;
+  if(fd < 0 || read(fd, &count, sizeof(count)) != sizeof(count))
+    return -1;
+  return count;
+}
+
+// keeps results alive so the compiler can't drop the calls
+static volatile double sink;
+
+/*
+ * Inputs shared by the cases
+ */
+typedef struct{
+  leapTable *table;
+  const timeZone *tz;
+  int64_t sec[SAMPLES]; // random UTC seconds from 1972 to 2030
+  int64_t sorted[SAMPLES]; // the same seconds in order
+  int32_t usec[SAMPLES];
+  double j2k[SAMPLES];
+  double msd[SAMPLES];
+  soldate dates[SAMPLES];
+  char iso[SAMPLES][32]; // the seconds as YYYY-MM-DDTHH:MM:SS.ffffffZ
+  char rfc[SAMPLES][32]; // and as YYYY-MM-DD HH:MM:SS+HH:MM
+  char epoch[SAMPLES][24]; // and as SECONDS.ffffff
+} benchData;
+
+typedef void (*benchFn)(benchData *d, long n);
+
+/*
+ * One benchmark, run for the number of calls divided by scale
+ */
+typedef struct{
+  const char *name;
+  benchFn fn;
+  int scale;
+} benchCase;
+
+/*
+ * Measurements of one case
+ */
+typedef struct{
+  char name[64];
+  double ns; // median of the repetitions, per call
+  double nsMin, nsMax; // fastest and slowest repetition, per call
+  double allocs, cycles; // per call, cycles < 0 if not counted
+} benchResult;
+
+////////////////////////////////////////////////////////////////////////////////
+// Cases
+////////////////////////////////////////////////////////////////////////////////
+
+static void benchOffset(benchData *d, long n){
+  long i, acc = 0;
+  for(i=0; i<n; i++)
+    acc += offset(d->sec[i & (SAMPLES-1)], d->table);
+  sink = acc;
+}
+
+static void benchUTCtoTAI(benchData *d, long n){
+  long i, acc = 0;
+  for(i=0; i<n; i++)
+    acc += UTCtoTAI(d->sec[i & (SAMPLES-1)], d->table);
+  sink = acc;
+}
+
+static void benchJ2KtoMSD(benchData *d, long n){
+  long i;
+  double acc = 0;
+  for(i=0; i<n; i++)
+    acc += J2KtoMSD(d->j2k[i & (SAMPLES-1)]);
+  sink = acc;
+}
+
+static void benchJ2KtoMSDInline(benchData *d, long n){
+  long i;
+  double acc = 0;
+  for(i=0; i<n; i++)
+    acc += J2KtoMSD_inline(d->j2k[i & (SAMPLES-1)]);
+  sink = acc;
+}
+
+static void benchMSDtoSoldate(benchData *d, long n){
+  long i, acc = 0;
+  for(i=0; i<n; i++){
+    soldate *date = MSDtoSoldate(d->msd[i & (SAMPLES-1)], d->tz);
+    acc += date->sec;
+    free(date);
+  }
+  sink = acc;
+}
+
+static void benchMSDtoSoldate_r(benchData *d, long n){
+  long i, acc = 0;
+  soldate date;
+  for(i=0; i<n; i++)
+    acc += MSDtoSoldate_r(d->msd[i & (SAMPLES-1)], d->tz, &date)->sec;
+  sink = acc;
+}
+
+static void benchSoldateToString(benchData *d, long n){
+  long i, acc = 0;
+  for(i=0; i<n; i++){
+    char *str = soldateToString(&d->dates[i & (SAMPLES-1)]);
+    acc += str[0];
+    free(str);
+  }
+  sink = acc;
+}
+
+static void benchSoldateFormat(benchData *d, long n){
+  long i, acc = 0;
+  char buf[64];
+  for(i=0; i<n; i++)
+    acc += soldateFormat(buf, sizeof(buf), &d->dates[i & (SAMPLES-1)]);
+  sink = acc;
+}
+
+static void benchLs(benchData *d, long n){
+  long i;
+  double acc = 0;
+  for(i=0; i<n; i++)
+    acc += Ls(d->j2k[i & (SAMPLES-1)]);
+  sink = acc;
+}
+
+static void benchEOT(benchData *d, long n){
+  long i;
+  double acc = 0;
+  for(i=0; i<n; i++)
+    acc += EOT(d->j2k[i & (SAMPLES-1)]);
+  sink = acc;
+}
+
+static void benchLsFast(benchData *d, long n){
+  long i;
+  double acc = 0;
+  for(i=0; i<n; i++)
+    acc += Ls_precision(d->j2k[i & (SAMPLES-1)], MARS_PRECISION_FAST);
+  sink = acc;
+}
+
+static void benchLsApprox(benchData *d, long n){
+  long i;
+  double acc = 0;
+  for(i=0; i<n; i++)
+    acc += Ls_precision(d->j2k[i & (SAMPLES-1)], MARS_PRECISION_APPROX);
+  sink = acc;
+}
+
+static void benchPBS(benchData *d, long n){
+  long i;
+  double acc = 0;
+  for(i=0; i<n; i++)
+    acc += PBS(d->j2k[i & (SAMPLES-1)]);
+  sink = acc;
+}
+
+/*
+ * Parses the timestamps in text, each held in size bytes
+ */
+static void parseTexts(const char *text, size_t size, long n){
+  long i, acc = 0;
+  int64_t sec;
+  int32_t usec;
+  for(i=0; i<n; i++){
+    const char *str = text + (i & (SAMPLES-1)) * size;
+    acc += parseTimestamp(str, strlen(str), &sec, &usec) + sec;
+  }
+  sink = acc;
+}
+
+static void benchParseISO(benchData *d, long n){
+  parseTexts(d->iso[0], sizeof(d->iso[0]), n);
+}
+
+static void benchParseRFC(benchData *d, long n){
+  parseTexts(d->rfc[0], sizeof(d->rfc[0]), n);
+}
+
+static void benchParseEpoch(benchData *d, long n){
+  parseTexts(d->epoch[0], sizeof(d->epoch[0]), n);
+}
+
+/*
+ * UTC seconds to a formatted sol date one timestamp at a time
+ */
+static void pipelineScalar(benchData *d, const int64_t *sec, long n){
+  long i, acc = 0;
+  char buf[64];
+  soldate date;
+  for(i=0; i<n; i++){
+    int j = i & (SAMPLES-1);
+    double tai = UTCtoTAI(sec[j], d->table) + d->usec[j] / 1e6;
+    MSDtoSoldate_r(TAItoMSD(tai), d->tz, &date);
+    acc += soldateFormat(buf, sizeof(buf), &date);
+  }
+  sink = acc;
+}
+
+/*
+ * UTC seconds to a formatted sol date, converting to MSD in batches
+ */
+static void pipelineBatch(benchData *d, const int64_t *sec, long n){
+  long done, acc = 0;
+  char buf[64];
+  soldate date;
+  double msd[SAMPLES];
+  for(done=0; done<n; done+=SAMPLES){
+    long k = n - done < SAMPLES ? n - done : SAMPLES;
+    UTCtoMSD_batch(sec, d->usec, msd, k, d->table);
+    long j;
+    for(j=0; j<k; j++){
+      MSDtoSoldate_r(msd[j], d->tz, &date);
+      acc += soldateFormat(buf, sizeof(buf), &date);
+    }
+  }
+  sink = acc;
+}
+
+/*
+ * UTC seconds to a formatted sol date through the exact integer chain,
+ * converting to MSD in batches
+ */
+static void pipelineFixed(benchData *d, const int64_t *sec, long n){
+  long done, acc = 0;
+  char buf[64];
+  soldate date;
+  int64_t tai[SAMPLES];
+  marsFixed msd[SAMPLES];
+  for(done=0; done<n; done+=SAMPLES){
+    long k = n - done < SAMPLES ? n - done : SAMPLES;
+    long j;
+    for(j=0; j<k; j++)
+      tai[j] = UTCtoTAI_ns(sec[j] * 1000000000LL + d->usec[j] * 1000LL,
+          d->table);
+    TAInsToFixed_batch(tai, msd, k);
+    for(j=0; j<k; j++){
+      fixedToSoldate_r(msd[j], d->tz, &date);
+      acc += soldateFormat(buf, sizeof(buf), &date);
+    }
+  }
+  sink = acc;
+}
+
+static void benchPipelineSorted(benchData *d, long n){
+  pipelineScalar(d, d->sorted, n);
+}
+
+static void benchPipelineRandom(benchData *d, long n){
+  pipelineScalar(d, d->sec, n);
+}
+
+static void benchBatchSorted(benchData *d, long n){
+  pipelineBatch(d, d->sorted, n);
+}
+
+static void benchBatchRandom(benchData *d, long n){
+  pipelineBatch(d, d->sec, n);
+}
+
+static void benchFixedSorted(benchData *d, long n){
+  pipelineFixed(d, d->sorted, n);
+}
+
+static void benchFixedRandom(benchData *d, long n){
+  pipelineFixed(d, d->sec, n);
+}
+
+/*
+ * Current MSD the way main() used to get it
+ */
+static void benchGettimeofday(benchData *d, long n){
+  long i;
+  for(i=0; i<n; i++){
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    sink = J2KtoMSD(TAItoJ2K(UTCstructToTAIfloat(&tv, d->table)));
+  }
+}
+
+/*
+ * Current MSD from CLOCK_REALTIME and the leap table
+ */
+static void benchRealtime(benchData *d, long n){
+  long i;
+  for(i=0; i<n; i++){
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    sink = TAItoMSD(ts.tv_sec + offset(ts.tv_sec, d->table) + ts.tv_nsec / 1e9);
+  }
+}
+
+static void benchClockTAI(benchData *d, long n){
+  long i;
+  for(i=0; i<n; i++){
+    struct timespec ts;
+    clock_gettime(CLOCK_TAI, &ts);
+    sink = ts.tv_nsec;
+  }
+}
+
+static void benchMarsNow(benchData *d, long n){
+  long i;
+  for(i=0; i<n; i++)
+    sink = marsNow(d->table);
+}
+
+static void benchMarsNowFixed(benchData *d, long n){
+  long i;
+  for(i=0; i<n; i++)
+    sink = marsNowFixed(d->table).ps;
+}
+
+static const benchCase cases[] = {
+  {"offset", benchOffset, 1},
+  {"UTCtoTAI", benchUTCtoTAI, 1},
+  {"J2KtoMSD", benchJ2KtoMSD, 1},
+  {"J2KtoMSD_inline", benchJ2KtoMSDInline, 1},
+  {"MSDtoSoldate", benchMSDtoSoldate, 4},
+  {"MSDtoSoldate_r", benchMSDtoSoldate_r, 1},
+  {"soldateToString", benchSoldateToString, 4},
+  {"soldateFormat", benchSoldateFormat, 4},
+  {"Ls", benchLs, 4},
+  {"Ls FAST", benchLsFast, 4},
+  {"Ls APPROX", benchLsApprox, 4},
+  {"EOT", benchEOT, 4},
+  {"PBS", benchPBS, 4},
+  {"parseTimestamp ISO-8601", benchParseISO, 2},
+  {"parseTimestamp RFC 3339", benchParseRFC, 2},
+  {"parseTimestamp epoch", benchParseEpoch, 2},
+  {"pipeline sorted", benchPipelineSorted, 8},
+  {"pipeline random", benchPipelineRandom, 8},
+  {"pipeline sorted batch", benchBatchSorted, 8},
+  {"pipeline random batch", benchBatchRandom, 8},
+  {"pipeline sorted fixed", benchFixedSorted, 8},
+  {"pipeline random fixed", benchFixedRandom, 8},
+  {"now gettimeofday+table", benchGettimeofday, 1},
+  {"now CLOCK_REALTIME+table", benchRealtime, 1},
+  {"now CLOCK_TAI", benchClockTAI, 1},
+  {"now marsNow", benchMarsNow, 1},
+  {"now marsNowFixed", benchMarsNowFixed, 1}
+};
+#define NCASES ((int)(sizeof(cases) / sizeof(*cases)))
+
+/*
+ * Orders seconds for qsort
+ */
+static int compareSec(const void *a, const void *b){
+  int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+  return (x > y) - (x < y);
+}
+
+/*
+ * Fills in the inputs of the cases from a fixed seed
+ */
+static void initData(benchData *d, leapTable *table){
+  d->table = table;
+  d->tz = &curiosity;
+  unsigned state = 1;
+  int i;
+  for(i=0; i<SAMPLES; i++){
+    state = state * 1103515245 + 12345;
+    d->sec[i] = 63072000 + (int64_t)(state >> 1) % 1830000000;
+    state = state * 1103515245 + 12345;
+    d->usec[i] = (state >> 8) % 1000000;
+    d->msd[i] = TAItoMSD(UTCtoTAI(d->sec[i], table) + d->usec[i] / 1e6);
+    d->j2k[i] = MSDtoJ2K(d->msd[i]);
+    MSDtoSoldate_r(d->msd[i], d->tz, &d->dates[i]);
+    struct tm tm;
+    time_t t = d->sec[i];
+    gmtime_r(&t, &tm);
+    char date[24];
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", &tm);
+    snprintf(d->iso[i], sizeof(d->iso[i]), "%s.%06dZ", date, d->usec[i]);
+    t += 2 * 3600;
+    gmtime_r(&t, &tm);
+    strftime(d->rfc[i], sizeof(d->rfc[i]), "%Y-%m-%d %H:%M:%S+02:00", &tm);
+    snprintf(d->epoch[i], sizeof(d->epoch[i]), "%lld.%06d",
+        (long long)d->sec[i], d->usec[i]);
+  }
+  memcpy(d->sorted, d->sec, sizeof(d->sorted));
+  qsort(d->sorted, SAMPLES, sizeof(int64_t), compareSec);
+}
+
+/*
+ * Orders doubles for qsort
+ */
+static int compareDouble(const void *a, const void *b){
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+/*
+ * Runs c for calls / c->scale calls, split into repeats timed repetitions,
+ * and stores the measurements in r
+ * cyclesfd is the counter from cyclesOpen, or -1
+ */
+static void runCase(const benchCase *c, benchData *d, long calls, int repeats,
+    int cyclesfd, benchResult *r){
+  long n = calls / c->scale / repeats;
+  if(n < 1)
+    n = 1;
+  c->fn(d, n / 4 + 1);
+  if(cyclesfd >= 0){
+    ioctl(cyclesfd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(cyclesfd, PERF_EVENT_IOC_ENABLE, 0);
+  }
+  double ns[MAXREPEATS];
+  unsigned long a = atomic_load(&allocs);
+  int k;
+  for(k=0; k<repeats; k++){
+    double t = monotonic();
+    c->fn(d, n);
+    ns[k] = (monotonic() - t) / n * 1e9;
+  }
+  a = atomic_load(&allocs) - a;
+  if(cyclesfd >= 0)
+    ioctl(cyclesfd, PERF_EVENT_IOC_DISABLE, 0);
+  long cycles = cyclesRead(cyclesfd);
+  qsort(ns, repeats, sizeof(double), compareDouble);
+  snprintf(r->name, sizeof(r->name), "%s", c->name);
+  r->ns = repeats % 2 ? ns[repeats / 2] :
+    (ns[repeats / 2 - 1] + ns[repeats / 2]) / 2;
+  r->nsMin = ns[0];
+  r->nsMax = ns[repeats - 1];
+  r->allocs = (double)a / n / repeats;
+  r->cycles = cycles < 0 ? -1 : (double)cycles / n / repeats;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Reports
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Prints the results as a table
+ */
+static void printResults(const benchResult *r, int n){
+  printf("%-28s %10s %8s %10s %10s\n", "case", "ns/op", "spread",
+      "allocs/op", "cycles/op");
+  int i;
+  for(i=0; i<n; i++){
+    double spread = r[i].ns > 0 ? (r[i].nsMax - r[i].nsMin) / r[i].ns * 100 :
+      0;
+    printf("%-28s %10.1f %7.1f%% %10.2f ", r[i].name, r[i].ns, spread,
+        r[i].allocs);
+    if(r[i].cycles < 0)
+      printf("%10s\n", "-");
+    else
+      printf("%10.1f\n", r[i].cycles);
+  }
+}
+
+/*
+ * Writes the results as JSON to filename ("-" for stdout), one case per line
+ * so that readBaseline can read them back
+ * Returns nonzero on error
+ */
+static int writeJSON(const char *filename, const benchResult *r, int n,
+    long calls, int repeats){
+  FILE *fp = strcmp(filename, "-") == 0 ? stdout : fopen(filename, "w");
+  if(fp == NULL){
+    printf("Cannot open file \"%s\"\n", filename);
+    return 1;
+  }
+  fprintf(fp, "{\n  \"version\": \"%s\",\n  \"calls\": %ld,\n"
+      "  \"repeats\": %d,\n  \"results\": [\n", MARSTIME_VERSION, calls,
+      repeats);
+  int i;
+  for(i=0; i<n; i++){
+    fprintf(fp, "    {\"name\": \"%s\", \"ns_per_op\": %.3f, "
+        "\"ns_min\": %.3f, \"ns_max\": %.3f, \"allocs_per_op\": %.3f, "
+        "\"cycles_per_op\": ", r[i].name, r[i].ns, r[i].nsMin, r[i].nsMax,
+        r[i].allocs);
+    if(r[i].cycles < 0)
+      fprintf(fp, "null}");
+    else
+      fprintf(fp, "%.3f}", r[i].cycles);
+    fprintf(fp, "%s\n", i < n - 1 ? "," : "");
+  }
+  fprintf(fp, "  ]\n}\n");
+  if(fp != stdout)
+    fclose(fp);
+  return 0;
+}
+
+/*
+ * Reads the number following "key": in line into value
+ * Returns 1 if it was found
+ */
+static int jsonNumber(const char *line, const char *key, double *value){
+  char pattern[64];
+  snprintf(pattern, sizeof(pattern), "\"%s\": ", key);
+  const char *p = strstr(line, pattern);
+  return p != NULL && sscanf(p + strlen(pattern), "%lf", value) == 1;
+}
+
+/*
+ * Reads the results written by writeJSON from filename into base, which has
+ * room for max results
+ * Baselines from before the repetitions have no ns_min, their single run
+ * stands in for it
+ * Returns how many were read, or -1 on error
+ */
+static int readBaseline(const char *filename, benchResult *base, int max){
+  FILE *fp = fopen(filename, "r");
+  if(fp == NULL){
+    printf("Cannot open file \"%s\"\n", filename);
+    return -1;
+  }
+  int n = 0;
+  char buffer[256];
+  while(n < max && fgets(buffer, sizeof(buffer), fp) != NULL){
+    char *p = strstr(buffer, "{\"name\"");
+    if(p == NULL)
+      continue;
+    benchResult *r = &base[n];
+    if(sscanf(p, "{\"name\": \"%63[^\"]\"", r->name) != 1 ||
+        !jsonNumber(p, "ns_per_op", &r->ns) ||
+        !jsonNumber(p, "allocs_per_op", &r->allocs))
+      continue;
+    if(!jsonNumber(p, "ns_min", &r->nsMin))
+      r->nsMin = r->ns;
+    if(!jsonNumber(p, "ns_max", &r->nsMax))
+      r->nsMax = r->ns;
+    r->cycles = -1;
+    n++;
+  }
+  fclose(fp);
+  return n;
+}
+
+/*
+ * Prints the fastest repetitions next to those of the baseline in filename
+ * and flags cases more than threshold percent slower, or that allocate more
+ * Returns the number of regressions, or -1 if the baseline can't be read
+ */
+static int compareBaseline(const char *filename, const benchResult *r, int n,
+    double threshold){
+  benchResult base[MAXCASES];
+  int nbase = readBaseline(filename, base, MAXCASES);
+  if(nbase < 0)
+    return -1;
+  printf("\n%-28s %10s %10s %8s\n", "case", "base min", "min", "change");
+  int regressions = 0;
+  int i;
+  for(i=0; i<n; i++){
+    const benchResult *b = NULL;
+    int j;
+    for(j=0; j<nbase; j++)
+      if(strcmp(base[j].name, r[i].name) == 0)
+        b = &base[j];
+    if(b == NULL){
+      printf("%-28s %10s %10.1f %8s\n", r[i].name, "-", r[i].nsMin, "new");
+      continue;
+    }
+    double change = b->nsMin > 0 ? (r[i].nsMin / b->nsMin - 1) * 100 : 0;
+    int slower = change > threshold;
+    int allocates = r[i].allocs > b->allocs + 0.005;
+    printf("%-28s %10.1f %10.1f %+7.1f%%%s%s\n", r[i].name, b->nsMin,
+        r[i].nsMin, change, slower ? "  REGRESSION" : "",
+        allocates ? "  MORE ALLOCATIONS" : "");
+    regressions += slower || allocates;
+  }
+  printf("%d regression%s against %s (threshold %.1f%%)\n", regressions,
+      regressions == 1 ? "" : "s", filename, threshold);
+  return regressions;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Accuracy mode
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Published values at one instant, angles in degrees and LMST and LTST in
+ * hours
+ */
+typedef struct{
+  const char *source;
+  int64_t utc; // UTC seconds since the Unix epoch
+  double lon; // degrees west at which LMST and LTST are given
+  double M, alphaFMS, PBS, EOC, Ls, EOT, msd, lmst, ltst, subsol;
+} goldenVector;
+
+// Mars24 Sunclock - Algorithm and Worked Examples (NASA GISS), Example A,
+// 2000-01-06 00:00:00 UTC at the prime meridian: every value it publishes
+// from B-1 to C-5 (C-3 as LMST at longitude 0), to 5 decimals.
+// The same instant at 90W and at the MSL site (137.4417E) takes LMST from
+// C-3 and LTST from C-4 applied to the published MST and EOT, so a
+// longitude sign or east/west mixup shows up as hours of error.
+// Example B, 2004-01-03 13:46:31 UTC at the MER-A site (184.702W), is the
+// instant of LTST midnight there; its values are the published equations
+// evaluated independently to 5 decimals, and its subsolar longitude is the
+// antipode of the site
+static const goldenVector goldens[] = {
+  {"Mars24 Example A", 947116800, 0, 21.74558, 272.74566, 0.00142, 4.44193,
+    277.18758, -5.18774, 44795.99976, 23.99425, 23.64840, 174.72601},
+  {"Example A 90W", 947116800, 90, 21.74558, 272.74566, 0.00142, 4.44193,
+    277.18758, -5.18774, 44795.99976, 17.99425, 17.64840, 174.72601},
+  {"Example A MSL site", 947116800, 222.5583, 21.74558, 272.74566, 0.00142,
+    4.44193, 277.18758, -5.18774, 44795.99976, 9.15703, 8.81118, 174.72601},
+  {"Mars24 Example B", 1073137591, 184.702, 66.06858, 317.09457, 0.01614,
+    10.22959, 327.32416, -12.77553, 46215.54856, 0.85190, 0.00020, 4.70500}
+};
+#define NGOLDENS ((int)(sizeof(goldens) / sizeof(*goldens)))
+
+/*
+ * One quantity checked against the golden vectors
+ */
+typedef struct{
+  const char *name;
+  const char *unit;
+  double tol; // largest error accepted
+  size_t field; // offset of the value in goldenVector
+} goldenCheck;
+
+// the published values are rounded to 5e-6, the tolerances leave as much
+// again for the rounding of the published inputs of each step
+static const goldenCheck checks[] = {
+  {"M", "deg", 1e-5, offsetof(goldenVector, M)},
+  {"alphaFMS", "deg", 1e-5, offsetof(goldenVector, alphaFMS)},
+  {"PBS", "deg", 1e-5, offsetof(goldenVector, PBS)},
+  {"EOC", "deg", 1e-5, offsetof(goldenVector, EOC)},
+  {"Ls", "deg", 2e-5, offsetof(goldenVector, Ls)},
+  {"EOT", "deg", 2e-5, offsetof(goldenVector, EOT)},
+  {"MSD", "sol", 1e-5, offsetof(goldenVector, msd)},
+  {"LMST", "h", 1e-5, offsetof(goldenVector, lmst)},
+  {"LTST", "h", 1e-5, offsetof(goldenVector, ltst)},
+  {"subsolLon", "deg", 2e-5, offsetof(goldenVector, subsol)}
+};
+#define NCHECKS ((int)(sizeof(checks) / sizeof(*checks)))
+
+/*
+ * Computes the quantities of a golden vector with this library
+ */
+static void computeGolden(const goldenVector *g, leapTable *table,
+    goldenVector *out){
+  *out = *g;
+  double msd = TAItoMSD(UTCtoTAI(g->utc, table));
+  double J2K = MSDtoJ2K(msd);
+  out->M = meanAnom(J2K);
+  out->alphaFMS = FMS(J2K);
+  out->PBS = PBS(J2K);
+  out->EOC = EOC(J2K);
+  out->Ls = fmod(Ls(J2K), 360);
+  out->EOT = EOT(J2K);
+  out->msd = msd;
+  out->lmst = fmod(LMST(msd, g->lon), 1) * 24;
+  out->ltst = fmod(LTST(msd, g->lon), 1) * 24;
+  out->subsol = subsolLon(msd);
+}
+
+/*
+ * Difference of angles in degrees, folded into [-180, 180)
+ */
+static double angleDiff(double a, double b){
+  double d = fmod(a - b, 360);
+  if(d >= 180)
+    d -= 360;
+  else if(d < -180)
+    d += 360;
+  return d;
+}
+
+/*
+ * Checks every golden vector and prints the largest error of each quantity
+ * Returns the number of quantities out of tolerance
+ */
+static int checkGoldens(leapTable *table){
+  double maxErr[NCHECKS] = {0};
+  int failures = 0;
+  int i, j;
+  printf("%-20s %-10s %14s %14s %10s\n", "vector", "value", "expected", "got",
+      "error");
+  for(i=0; i<NGOLDENS; i++){
+    goldenVector got;
+    computeGolden(&goldens[i], table, &got);
+    for(j=0; j<NCHECKS; j++){
+      double want = *(const double *)((const char *)&goldens[i] +
+          checks[j].field);
+      double have = *(const double *)((const char *)&got + checks[j].field);
+      double err = strcmp(checks[j].unit, "deg") == 0 ?
+        angleDiff(have, want) : have - want;
+      if(strcmp(checks[j].unit, "h") == 0 && fabs(err) > 12)
+        err -= copysign(24, err);
+      int bad = fabs(err) > checks[j].tol;
+      failures += bad;
+      if(fabs(err) > maxErr[j])
+        maxErr[j] = fabs(err);
+      printf("%-20s %-10s %14.5f %14.5f %10.2e%s\n", goldens[i].source,
+          checks[j].name, want, have, err, bad ? "  FAIL" : "");
+    }
+  }
+  printf("\n%-10s %10s %10s\n", "value", "max error", "tolerance");
+  for(j=0; j<NCHECKS; j++)
+    printf("%-10s %10.2e %10.2e %s\n", checks[j].name, maxErr[j],
+        checks[j].tol, checks[j].unit);
+  return failures;
+}
+
+/*
+ * Measures the largest error of each precision against FULL over 1900-2100
+ * and its time per call of Ls_precision and EOT_precision
+ * Returns the number of precisions whose error exceeds their bound
+ */
+static int checkPrecisions(){
+  static const char *names[] = {"FULL", "FAST", "APPROX"};
+  const double step = 0.37;
+  const long n = 2 * 36525 / step;
+  double *full = malloc(2 * n * sizeof(double));
+  if(full == NULL){
+    printf("Unable to alloc accuracy samples\n");
+    exit(1);
+  }
+  long i;
+  for(i=0; i<n; i++){
+    double J2K = -36525 + i * step;
+    full[2*i] = Ls(J2K);
+    full[2*i+1] = EOT(J2K);
+  }
+  printf("\n%-10s %12s %12s %14s %10s %10s %10s\n", "precision", "Ls error",
+      "EOT error", "LTST error (s)", "bound", "Ls ns/op", "EOT ns/op");
+  int failures = 0;
+  marsPrecision p;
+  for(p=MARS_PRECISION_FULL; p<=MARS_PRECISION_APPROX; p++){
+    double errLs = 0, errEOT = 0;
+    for(i=0; i<n; i++){
+      double J2K = -36525 + i * step;
+      double e = fabs(Ls_precision(J2K, p) - full[2*i]);
+      if(e > errLs)
+        errLs = e;
+      e = fabs(EOT_precision(J2K, p) - full[2*i+1]);
+      if(e > errEOT)
+        errEOT = e;
+    }
+    double acc = 0;
+    double t = monotonic();
+    for(i=0; i<n; i++)
+      acc += Ls_precision(-36525 + i * step, p);
+    t = monotonic() - t;
+    double tEOT = monotonic();
+    for(i=0; i<n; i++)
+      acc += EOT_precision(-36525 + i * step, p);
+    tEOT = monotonic() - tEOT;
+    sink = acc;
+    double bound = marsPrecisionBound(p);
+    int bad = errLs > bound || errEOT > bound;
+    failures += bad;
+    printf("%-10s %12.2e %12.2e %14.3f %10.3f %10.1f %10.1f%s\n", names[p],
+        errLs, errEOT, errEOT / 360 * 86400, bound, t / n * 1e9,
+        tEOT / n * 1e9, bad ? "  FAIL" : "");
+  }
+  free(full);
+  return failures;
+}
+
+/*
+ * Prints one row of the API checks
+ * Returns 1 if err exceeds tol
+ */
+static int reportCheck(const char *name, double err, double tol){
+  int bad = !(err <= tol);
+  printf("%-32s %10.2e %10.2e%s\n", name, err, tol, bad ? "  FAIL" : "");
+  return bad;
+}
+
+/*
+ * Saves a fitted cache, maps it back and compares the two: the header must
+ * match and every evaluation must be bit for bit the same
+ * Returns the number of failed checks
+ */
+static int checkEphemeris(){
+  ephemCache *built = ephemBuild(0, 3 * 365.25, 1e-6);
+  if(built == NULL){
+    printf("Unable to build ephemeris cache\n");
+    exit(1);
+  }
+  char path[] = "/tmp/marsEphemXXXXXX";
+  int fd = mkstemp(path);
+  if(fd < 0){
+    printf("Unable to create %s\n", path);
+    exit(1);
+  }
+  close(fd);
+  ephemCache *mapped = NULL;
+  if(ephemSave(built, path) == 0)
+    mapped = ephemMap(path);
+  unlink(path);
+  if(mapped == NULL){
+    ephemFree(built);
+    return reportCheck("ephemSave/ephemMap", INFINITY, 0);
+  }
+  double err = mapped->start != built->start || mapped->end != built->end ||
+    mapped->segLen != built->segLen || mapped->degree != built->degree ||
+    mapped->nseg != built->nseg ? INFINITY : 0;
+  double errLs = 0;
+  double J2K;
+  for(J2K=-10; J2K<3*365.25+10; J2K+=0.173){
+    double e = fabs(ephemLs(mapped, J2K) - ephemLs(built, J2K)) +
+      fabs(ephemEOT(mapped, J2K) - ephemEOT(built, J2K));
+    if(e > err)
+      err = e;
+    e = fabs(angleDiff(ephemLs(mapped, J2K), Ls(J2K)));
+    if(e > errLs)
+      errLs = e;
+  }
+  ephemFree(mapped);
+  ephemFree(built);
+  return reportCheck("ephemSave/ephemMap", err, 0) +
+    reportCheck("ephemMap Ls vs Ls (deg)", errLs, 1e-6);
+}
+
+/*
+ * Returns nonzero if a and b are the same date and time in the same zone
+ */
+static int sameDarian(const marsCalDate *a, const marsCalDate *b){
+  return a->year == b->year && a->month == b->month && a->sol == b->sol &&
+    a->hour == b->hour && a->min == b->min && a->sec == b->sec &&
+    a->tz == b->tz;
+}
+
+/*
+ * Converts MSDs over three Darian cycles to dates, the dates to MSD and back
+ * again: the second trip must give the same dates, and the batch must agree
+ * with MSDtoDarian_r
+ * Returns the number of failed checks
+ */
+static int checkDarian(){
+  enum{N = 4096};
+  static double msd[N], back[N];
+  static marsCalDate dates[N], again[N];
+  const double span = 3.0 * DARIAN_CYCLE_SOLS;
+  int i;
+  for(i=0; i<N; i++)
+    msd[i] = DARIAN_EPOCH - DARIAN_CYCLE_SOLS + span * i / N + i * 0.0137;
+  MSDtoDarian_batch(msd, NULL, dates, N);
+  for(i=0; i<N; i++)
+    back[i] = DarianToMSD(&dates[i]);
+  MSDtoDarian_batch(back, NULL, again, N);
+  int trips = 0, mismatches = 0;
+  for(i=0; i<N; i++){
+    trips += !sameDarian(&dates[i], &again[i]);
+    marsCalDate one;
+    MSDtoDarian_r(msd[i], NULL, &one);
+    mismatches += !sameDarian(&one, &dates[i]);
+  }
+  return reportCheck("Darian -> MSD -> Darian", trips, 0) +
+    reportCheck("MSDtoDarian_batch vs scalar", mismatches, 0);
+}
+
+/*
+ * Converts sol dates over the hours around the leap second at the end of
+ * 2016 to UTC and back: the dates must come back the same, and the UTC times
+ * from soldateToUTC_batch and MSDtoUTC_parallel must match MSDtoUTC_batch
+ * Returns the number of failed checks
+ */
+static int checkSoldateUTC(leapTable *table){
+  enum{N = 8192};
+  static int64_t sec[N], back[N], batch[N], par[N];
+  static int32_t usec[N], backUsec[N], batchUsec[N], parUsec[N];
+  static double msd[N];
+  static soldate dates[N], again[N];
+  int i;
+  for(i=0; i<N; i++){
+    int64_t us = (int64_t)i * 1370011 - (int64_t)N / 2 * 1370011;
+    sec[i] = 1483228800 + us / 1000000 - (us % 1000000 < 0);
+    usec[i] = (us % 1000000 + 1000000) % 1000000;
+  }
+  UTCtoMSD_batch(sec, usec, msd, N, table);
+  for(i=0; i<N; i++)
+    MSDtoSoldate_r(msd[i], &MTC, &dates[i]);
+  soldateToUTC_batch(dates, back, backUsec, N, table);
+  UTCtoMSD_batch(back, backUsec, msd, N, table);
+  int trips = 0;
+  for(i=0; i<N; i++){
+    MSDtoSoldate_r(msd[i], &MTC, &again[i]);
+    trips += again[i].sol != dates[i].sol || again[i].hour != dates[i].hour ||
+      again[i].min != dates[i].min || again[i].sec != dates[i].sec;
+    msd[i] = soldateToMSD(&dates[i]);
+  }
+  MSDtoUTC_batch(msd, batch, batchUsec, N, table);
+  MSDtoUTC_parallel(msd, par, parUsec, N, table, 4);
+  int batchDiffs = 0, parDiffs = 0;
+  for(i=0; i<N; i++){
+    batchDiffs += back[i] != batch[i] || backUsec[i] != batchUsec[i];
+    parDiffs += par[i] != batch[i] || parUsec[i] != batchUsec[i];
+  }
+  return reportCheck("soldate -> UTC -> soldate", trips, 0) +
+    reportCheck("soldateToUTC_batch vs MSDtoUTC", batchDiffs, 0) +
+    reportCheck("MSDtoUTC_parallel vs batch", parDiffs, 0);
+}
+
+/*
+ * Compares LTST_batch with LTST over every longitude at instants spread over
+ * two centuries; the count is odd so that the scalar tail is checked too
+ * Returns the number of failed checks
+ */
+static int checkLTSTBatch(){
+  enum{N = 1001};
+  static double lon[N], ltst[N];
+  int i;
+  for(i=0; i<N; i++)
+    lon[i] = 360.0 * i / (N - 1);
+  double err = 0;
+  double MSD;
+  for(MSD=44796 - 36525 / 1.0274912517; MSD<44796 + 36525 / 1.0274912517;
+      MSD+=97.3){
+    LTST_batch(MSD, lon, ltst, N);
+    for(i=0; i<N; i++){
+      double e = fabs(ltst[i] - LTST(MSD, lon[i])) * 86400;
+      if(e > err)
+        err = e;
+    }
+  }
+  return reportCheck("LTST_batch vs LTST (s)", err, 1e-4);
+}
+
+/*
+ * Compares UTCtoMSD_parallel and MSDtoSoldate_parallel on four threads with
+ * their serial versions over random times from 1972 to 2030, a little over
+ * three chunks so that the chunks and the last partial one are all checked
+ * Returns the number of failed checks
+ */
+static int checkParallel(leapTable *table){
+  const size_t n = 3 * (1 << 16) + 123;
+  int64_t *sec = malloc(n * sizeof(int64_t));
+  int32_t *usec = malloc(n * sizeof(int32_t));
+  double *serial = malloc(n * sizeof(double));
+  double *par = malloc(n * sizeof(double));
+  soldate *dates = malloc(2 * n * sizeof(soldate));
+  if(sec == NULL || usec == NULL || serial == NULL || par == NULL ||
+      dates == NULL){
+    printf("Unable to alloc parallel samples\n");
+    exit(1);
+  }
+  unsigned state = 7;
+  size_t i;
+  for(i=0; i<n; i++){
+    state = state * 1103515245 + 12345;
+    sec[i] = 63072000 + (int64_t)(state >> 1) % 1830000000;
+    state = state * 1103515245 + 12345;
+    usec[i] = (state >> 8) % 1000000;
+  }
+  UTCtoMSD_batch(sec, usec, serial, n, table);
+  UTCtoMSD_parallel(sec, usec, par, n, table, 4);
+  MSDtoSoldate_parallel(serial, &curiosity, dates + n, n, 4);
+  int msdDiffs = 0, dateDiffs = 0;
+  for(i=0; i<n; i++){
+    msdDiffs += par[i] != serial[i];
+    MSDtoSoldate_r(serial[i], &curiosity, &dates[i]);
+    const soldate *a = &dates[i], *b = &dates[n+i];
+    dateDiffs += a->sol != b->sol || a->hour != b->hour || a->min != b->min ||
+      a->sec != b->sec || a->tz != b->tz;
+  }
+  free(sec);
+  free(usec);
+  free(serial);
+  free(par);
+  free(dates);
+  return reportCheck("UTCtoMSD_parallel vs batch", msdDiffs, 0) +
+    reportCheck("MSDtoSoldate_parallel vs serial", dateDiffs, 0);
+}
+
+/*
+ * A timestamp and what parseTimestamp must make of it
+ */
+typedef struct{
+  const char *text;
+  int ok; // 1 if it must be accepted
+  int64_t sec;
+  int32_t usec;
+} parseCase;
+
+static const parseCase parseCases[] = {
+  {"2000-01-06T00:00:00Z", 1, 947116800, 0},
+  {"2000-01-06 01:00:00.5+01:00", 1, 947116800, 500000},
+  {"2000-01-05t22:30:00,25-0130", 1, 947116800, 250000},
+  {"2000-01-06T01:00+01", 1, 947116800, 0},
+  {"2016-12-31T23:59:60Z", 1, 1483228800, 0},
+  {"2000-01-06", 1, 947116800, 0},
+  {" 947116800.25\r\n", 1, 947116800, 250000},
+  {"@-1.5", 1, -2, 500000},
+  {"1.", 0, 0, 0},
+  {"@", 0, 0, 0},
+  {"-.5", 0, 0, 0},
+  {"2000-01-06T00:00:00.", 0, 0, 0},
+  {"2000-01-06T00:00:00+01:", 0, 0, 0},
+  {"2000-01-06T00:00:00+01:0", 0, 0, 0},
+  {"2000-01-06T00:00:00+24", 0, 0, 0},
+  {"2000-02-30", 0, 0, 0},
+  {"2000-01-06T24:00", 0, 0, 0},
+  {"2000-01-06T00:00:61", 0, 0, 0}
+};
+#define NPARSECASES ((int)(sizeof(parseCases) / sizeof(*parseCases)))
+
+/*
+ * Runs parseTimestamp on timestamps it must accept or reject
+ * Returns the number of failed checks
+ */
+static int checkParser(){
+  int wrong = 0;
+  int i;
+  for(i=0; i<NPARSECASES; i++){
+    const parseCase *c = &parseCases[i];
+    int64_t sec = 0;
+    int32_t usec = 0;
+    int ok = parseTimestamp(c->text, strlen(c->text), &sec, &usec);
+    if(ok != c->ok || (ok && (sec != c->sec || usec != c->usec))){
+      printf("parseTimestamp(\"%s\") = %d, %lld.%06d  FAIL\n", c->text, ok,
+          (long long)sec, usec);
+      wrong++;
+    }
+  }
+  return reportCheck("parseTimestamp accept/reject", wrong, 0);
+}
+
+/*
+ * Runs the accuracy checks
+ * Returns nonzero if any of them failed
+ */
+static int accuracy(leapTable *table){
+  int failures = checkGoldens(table) + checkPrecisions();
+  printf("\n%-32s %10s %10s\n", "round trip", "max error", "tolerance");
+  failures += checkEphemeris();
+  failures += checkDarian();
+  failures += checkSoldateUTC(table);
+  failures += checkLTSTBatch();
+  failures += checkParallel(table);
+  failures += checkParser();
+  printf("\naccuracy: %d failure%s\n", failures, failures == 1 ? "" : "s");
+  return failures != 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Stress mode
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Arguments of one stress thread
+ */
+typedef struct{
+  marsContext *ctx;
+  long n;
+  int seed;
+  long errors; // results that differ from the reference chain
+  atomic_int *done; // threads finished so far
+} stressJob;
+
+// leap seconds added by the tables the stress mode swaps in, after any
+// time the readers convert so that their reference stays valid
+// (2040-01-01 and 2041-01-01 in NTP seconds)
+static const int64_t stressLeaps[2] = {4417977600LL, 4449600000LL};
+
+/*
+ * Runs mixed context conversions and checks them against the plain chain
+ * computed with a table of the same contents
+ */
+static void* stressThread(void *p){
+  stressJob *job = p;
+  marsContext *ctx = job->ctx;
+  leapTable *ref = getLeapTable();
+  unsigned state = job->seed;
+  long i;
+  for(i=0; i<job->n; i++){
+    state = state * 1103515245 + 12345;
+    int64_t sec = (int64_t)(state % 1600000000u) + 63072000;
+    double msd = UTCtoMSD_r(ctx, sec, 0);
+    double want = TAItoMSD(UTCtoTAI(sec, ref));
+    if(fabs(msd - want) > 1e-9)
+      job->errors++;
+    struct timeval tv;
+    MSDtoUTC_r(ctx, msd, &tv);
+    if(llabs(tv.tv_sec - sec) > 1)
+      job->errors++;
+    soldate date;
+    UTCtoSoldate_r(ctx, sec, 0, findZone_r(ctx, i & 1 ? "MSD" : "MER-B"),
+        &date);
+    char buf[64];
+    if(soldateFormat(buf, sizeof(buf), &date) < 0 ||
+        timestr_r(sec, buf, sizeof(buf))[0] != '1' + (sec >= 946684800))
+      job->errors++;
+  }
+  atomic_fetch_add(job->done, 1);
+  return NULL;
+}
+
+/*
+ * Writes text, a leap second file, to path with its #$ stamp raised by
+ * version and one more leap second, alternating between two dates
+ * The file is written next to path and renamed onto it like update.sh does
+ * Returns nonzero on error
+ */
+static int writeStressTable(const char *path, const char *text, int64_t stamp,
+    int last, int version){
+  char tmp[4096];
+  snprintf(tmp, sizeof(tmp), "%s.new", path);
+  FILE *fp = fopen(tmp, "w");
+  if(fp == NULL)
+    return 1;
+  const char *line = text;
+  while(*line != '\0'){
+    const char *end = strchr(line, '\n');
+    size_t len = end != NULL ? (size_t)(end - line + 1) : strlen(line);
+    if(strncmp(line, "#$", 2) == 0)
+      fprintf(fp, "#$\t %lld\n", (long long)(stamp + version));
+    else
+      fwrite(line, 1, len, fp);
+    line += len;
+  }
+  fprintf(fp, "%lld\t%d\t# stress table %d\n",
+      (long long)stressLeaps[version & 1], last + 1, version);
+  int err = fclose(fp) != 0;
+  return err || rename(tmp, path) != 0;
+}
+
+/*
+ * Runs n conversions on each of threads threads sharing one context
+ * With a leap file, the context reads a copy of it in a temporary directory
+ * that the main thread keeps replacing with newer tables, adding one leap
+ * second after the converted times, until the readers are done. The
+ * watcher and direct reloads both swap them in, so the pointer swap, the
+ * wait for readers and the free of the old table run next to the readers
+ * Meant to be run under ThreadSanitizer, see make stress
+ * Fails if any conversion is wrong or no table was swapped in
+ */
+static int stress(int threads, long n, const char *leapfile){
+  char dir[] = "/tmp/marsStressXXXXXX";
+  char path[64] = "";
+  char *text = NULL;
+  int64_t stamp = 0;
+  int last = 0;
+  if(leapfile != NULL){
+    FILE *fp = fopen(leapfile, "r");
+    if(fp == NULL){
+      printf("Cannot open file \"%s\"\n", leapfile);
+      return 1;
+    }
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    rewind(fp);
+    text = malloc(size + 1);
+    if(text == NULL){
+      printf("Unable to alloc leap file\n");
+      exit(1);
+    }
+    text[fread(text, 1, size, fp)] = '\0';
+    fclose(fp);
+    const char *p = strstr(text, "#$");
+    stamp = p != NULL ? strtoll(p + 2, NULL, 10) : 0;
+    // the built in table is generated from the same file
+    leapTable *table = getLeapTable();
+    last = table->offsets[table->size - 1];
+    if(mkdtemp(dir) == NULL){
+      printf("Cannot create a temporary directory\n");
+      return 1;
+    }
+    snprintf(path, sizeof(path), "%s/leap-seconds", dir);
+    if(writeStressTable(path, text, stamp, last, 0) != 0){
+      printf("Cannot write \"%s\"\n", path);
+      return 1;
+    }
+  }
+
+  marsContext *ctx = marsContextNew(leapfile != NULL ? path : NULL, NULL);
+  if(leapfile != NULL && marsContextWatch(ctx) != 0)
+    return 1;
+  atomic_int done;
+  atomic_init(&done, 0);
+  stressJob jobs[threads];
+  pthread_t ids[threads];
+  int i;
+  for(i=0; i<threads; i++){
+    jobs[i] = (stressJob){.ctx = ctx, .n = n, .seed = i + 1, .errors = 0,
+      .done = &done};
+    pthread_create(&ids[i], NULL, stressThread, &jobs[i]);
+  }
+  long errors = 0;
+  int version;
+  for(version=1; leapfile != NULL && atomic_load(&done) < threads;
+      version++){
+    if(writeStressTable(path, text, stamp, last, version) != 0){
+      printf("Cannot write \"%s\"\n", path);
+      errors++;
+      break;
+    }
+    // every other table is also reloaded here, racing the watcher
+    if(version & 1)
+      leapSourceReload(ctx->leap);
+    struct timespec ts = {0, 1000000};
+    nanosleep(&ts, NULL);
+  }
+  for(i=0; i<threads; i++){
+    pthread_join(ids[i], NULL);
+    errors += jobs[i].errors;
+  }
+  unsigned long swaps = leapSourceReloads(ctx->leap);
+  marsContextFree(ctx);
+  if(leapfile != NULL){
+    unlink(path);
+    rmdir(dir);
+    free(text);
+  }
+  printf("stress: %d threads x %ld conversions, %lu of %d tables swapped "
+      "in, %ld errors\n", threads, n, swaps, version - 1, errors);
+  if(leapfile != NULL && swaps == 0){
+    printf("stress: no table was swapped in\n");
+    return 1;
+  }
+  return errors != 0;
+}
+
+/*
+ * Prints how to run the benchmark
+ */
+static void usage(const char *name){
+  printf("Usage: %s [OPTIONS] [CALLS]\n"
+      "  CALLS                 calls per case, divided by the case's scale "
+      "(default 10000000)\n"
+      "  --json FILE           write the results as JSON, - for stdout\n"
+      "  --compare FILE        flag regressions against results written by "
+      "--json\n"
+      "  --threshold PCT       slowdown flagged by --compare (default %.0f)\n"
+      "  --repeat N            time each case in N repetitions (default %d)\n"
+      "  --filter TEXT         only run the cases whose name contains TEXT\n"
+      "  --accuracy            check against reference values and measure "
+      "the\n"
+      "                        precision tiers\n"
+      "  --stress THREADS CALLS [LEAPFILE]\n"
+      "                        check conversions from threads sharing one "
+      "context\n", name, THRESHOLD, REPEATS);
+}
+
+int main(int argc, char *argv[]){
+  if(argc > 1 && strcmp(argv[1], "--stress") == 0){
+    int threads = argc > 2 ? atoi(argv[2]) : 8;
+    long n = argc > 3 ? atol(argv[3]) : 1000000;
+    if(threads <= 0 || n <= 0){
+      usage(argv[0]);
+      return 1;
+    }
+    return stress(threads, n, argc > 4 ? argv[4] : NULL);
+  }
+  if(argc > 1 && strcmp(argv[1], "--accuracy") == 0)
+    return accuracy(getLeapTable());
+  long calls = 10000000;
+  const char *json = NULL, *baseline = NULL, *filter = NULL;
+  double threshold = THRESHOLD;
+  int repeats = REPEATS;
+  int i;
+  for(i=1; i<argc; i++){
+    if(strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+      json = argv[++i];
+    else if(strcmp(argv[i], "--compare") == 0 && i + 1 < argc)
+      baseline = argv[++i];
+    else if(strcmp(argv[i], "--threshold") == 0 && i + 1 < argc)
+      threshold = atof(argv[++i]);
+    else if(strcmp(argv[i], "--repeat") == 0 && i + 1 < argc &&
+        atoi(argv[i + 1]) > 0 && atoi(argv[i + 1]) <= MAXREPEATS)
+      repeats = atoi(argv[++i]);
+    else if(strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+      filter = argv[++i];
+    else if(argv[i][0] != '-' && atol(argv[i]) > 0)
+      calls = atol(argv[i]);
+    else{
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  leapTable *table = getLeapTable();
+  static const char *sources[] = {"unknown", "CLOCK_TAI", "leap table"};
+  int src = marsNowInit(table);
+  printf("marsNow source: %s (kernel TAI-UTC %d s, table %d s)\n",
+      sources[src], kernelTAIOffset(), offset(time(NULL), table));
+  int cyclesfd = cyclesOpen();
+  if(cyclesfd < 0)
+    printf("perf events not available, cycles are not counted\n");
+
+  benchData *data = malloc(sizeof(benchData));
+  if(data == NULL){
+    printf("Unable to alloc benchmark data\n");
+    exit(1);
+  }
+  initData(data, table);
+  benchResult results[NCASES];
+  int n = 0;
+  for(i=0; i<NCASES; i++)
+    if(filter == NULL || strstr(cases[i].name, filter) != NULL)
+      runCase(&cases[i], data, calls, repeats, cyclesfd,
+          &results[n++]);
+  printResults(results, n);
+  free(data);
+  if(cyclesfd >= 0)
+    close(cyclesfd);
+
+  if(json != NULL && writeJSON(json, results, n, calls, repeats) != 0)
+    return 1;
+  if(baseline != NULL){
+    int regressions = compareBaseline(baseline, results, n, threshold);
+    if(regressions != 0)
+      return regressions < 0 ? 1 : 2;
+  }
+  return 0;
+}
@@ -0,0 +1,223 @@
+/*
+ * Self-describing binary files of named int64 and double columns
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "columns.h"
+
+#define COLUMNS_MAGIC "MTCOLS01"
+// most columns in a file
+#define COLUMNS_MAX 4096
+
+/*
+ * Layout of the start of a column file, the descriptors follow it
+ */
+typedef struct{
+  char magic[8];
+  uint32_t version;
+  uint32_t ncols;
+  uint64_t rows;
+  uint64_t reserved[5];
+} columnHeader;
+
+/*
+ * Rounds n up to a multiple of 64
+ */
+static inline uint64_t align64(uint64_t n){
+  return (n + 63) & ~(uint64_t)63;
+}
+
+/*
+ * Returns 1 if the file at path starts like a column file
+ */
+int columnsSniff(const char *path){
+  int fd = open(path, O_RDONLY);
+  if(fd < 0)
+    return 0;
+  char magic[8];
+  int is = read(fd, magic, 8) == 8 && memcmp(magic, COLUMNS_MAGIC, 8) == 0;
+  close(fd);
+  return is;
+}
+
+/*
+ * Maps the column file at path
+ * Returns NULL if it can't be read or isn't a valid column file
+ */
+columnFile* columnsOpen(const char *path){
+  int fd = open(path, O_RDONLY);
+  if(fd < 0)
+    return NULL;
+  struct stat st;
+  if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(columnHeader)){
+    close(fd);
+    return NULL;
+  }
+  void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if(map == MAP_FAILED)
+    return NULL;
+
+  const columnHeader *h = map;
+  size_t size = st.st_size;
+  int ok = memcmp(h->magic, COLUMNS_MAGIC, 8) == 0 && h->version == 1 &&
+    h->ncols <= COLUMNS_MAX && h->rows <= size / sizeof(uint64_t) &&
+    sizeof(columnHeader) + h->ncols * sizeof(columnDesc) <= size;
+  const columnDesc *cols = (const columnDesc *)(h + 1);
+  uint32_t i;
+  for(i=0; ok && i<h->ncols; i++){
+    const columnDesc *c = &cols[i];
+    ok = (c->type == COLUMN_INT64 || c->type == COLUMN_DOUBLE) &&
+      memchr(c->name, '\0', sizeof(c->name)) != NULL &&
+      c->offset % 64 == 0 && c->offset <= size &&
+      h->rows * sizeof(uint64_t) <= size - c->offset;
+  }
+  if(!ok){
+    munmap(map, size);
+    return NULL;
+  }
+  madvise(map, size, MADV_SEQUENTIAL);
+
+  columnFile *file = malloc(sizeof(columnFile));
+  if(file == NULL){
+    printf("Unable to alloc column file\n");
+    exit(1);
+  }
+  file->rows = h->rows;
+  file->ncols = h->ncols;
+  file->cols = cols;
+  file->map = map;
+  file->mapLen = size;
+  return file;
+}
+
+/*
+ * Returns the index of the column called name, or -1 if there is none
+ */
+int columnFind(const columnFile *file, const char *name){
+  int i;
+  for(i=0; i<file->ncols; i++)
+    if(strcmp(file->cols[i].name, name) == 0)
+      return i;
+  return -1;
+}
+
+/*
+ * Returns the values of column col, which are aligned to 64 bytes
+ */
+const void* columnData(const columnFile *file, int col){
+  return (const char *)file->map + file->cols[col].offset;
+}
+
+/*
+ * Unmaps a file returned by columnsOpen
+ */
+void columnsClose(columnFile *file){
+  if(file == NULL)
+    return;
+  munmap(file->map, file->mapLen);
+  free(file);
+}
+
+/*
+ * Writes all of buf to fd at off
+ */
+static int pwriteAll(int fd, const void *buf, size_t len, uint64_t off){
+  const char *p = buf;
+  while(len > 0){
+    ssize_t n = pwrite(fd, p, len, off);
+    if(n < 0){
+      if(errno == EINTR)
+        continue;
+      return 1;
+    }
+    p += n;
+    off += n;
+    len -= n;
+  }
+  return 0;
+}
+
+/*
+ * Creates a column file at path with rows rows and the given columns, all of
+ * them zero, replacing any file there
+ * Returns NULL if the file can't be created or a name is too long
+ */
+columnWriter* columnsCreate(const char *path, size_t rows, int ncols,
+    const char *const *names, const uint32_t *types){
+  if(ncols < 0 || ncols > COLUMNS_MAX)
+    return NULL;
+  columnWriter *w = malloc(sizeof(columnWriter));
+  columnDesc *cols = calloc(ncols > 0 ? ncols : 1, sizeof(columnDesc));
+  if(w == NULL || cols == NULL){
+    printf("Unable to alloc column file\n");
+    exit(1);
+  }
+  uint64_t off = align64(sizeof(columnHeader) + ncols * sizeof(columnDesc));
+  int i;
+  for(i=0; i<ncols; i++){
+    if(strlen(names[i]) > COLUMN_NAMELEN){
+      printf("Column name \"%s\" is too long\n", names[i]);
+      free(cols);
+      free(w);
+      return NULL;
+    }
+    strcpy(cols[i].name, names[i]);
+    cols[i].type = types[i];
+    cols[i].offset = off;
+    off = align64(off + rows * sizeof(uint64_t));
+  }
+
+  columnHeader h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, COLUMNS_MAGIC, 8);
+  h.version = 1;
+  h.ncols = ncols;
+  h.rows = rows;
+  w->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if(w->fd < 0 || ftruncate(w->fd, off) != 0 ||
+      pwriteAll(w->fd, &h, sizeof(h), 0) != 0 ||
+      pwriteAll(w->fd, cols, ncols * sizeof(columnDesc), sizeof(h)) != 0){
+    printf("Cannot write file \"%s\"\n", path);
+    if(w->fd >= 0)
+      close(w->fd);
+    free(cols);
+    free(w);
+    return NULL;
+  }
+  w->rows = rows;
+  w->ncols = ncols;
+  w->cols = cols;
+  return w;
+}
+
+/*
+ * Writes count values of column col starting at row; may be called from
+ * several threads at once
+ * Returns 0 on success
+ */
+int columnsWrite(columnWriter *w, int col, size_t row, const void *values,
+    size_t count){
+  if(col < 0 || col >= w->ncols || row > w->rows || count > w->rows - row)
+    return 1;
+  return pwriteAll(w->fd, values, count * sizeof(uint64_t),
+      w->cols[col].offset + row * sizeof(uint64_t));
+}
+
+/*
+ * Closes a file returned by columnsCreate
+ * Returns 0 if everything was written
+ */
+int columnsFinish(columnWriter *w){
+  int err = close(w->fd) != 0;
+  free(w->cols);
+  free(w);
+  return err;
+}
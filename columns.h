@@ -0,0 +1,117 @@
+/*
+ * Self-describing binary files of named int64 and double columns
+ *
+ * A file starts with a 64 byte header followed by one 64 byte descriptor per
+ * column, and then the columns themselves, each starting at a multiple of 64
+ * bytes and holding one value per row. Values use the byte order of the
+ * machine writing the file. Readers map the file and use the columns in
+ * place; writers fix the layout up front and can then write any rows of any
+ * column in any order, so large outputs are written a chunk at a time.
+ */
+
+#ifndef marscolumns
+#define marscolumns
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// longest column name, without the terminator
+#define COLUMN_NAMELEN 39
+
+/*
+ * Types of values a column can hold
+ */
+enum columnType{
+  COLUMN_INT64 = 1,
+  COLUMN_DOUBLE = 2
+};
+
+/*
+ * Descriptor of one column as stored in the file, 64 bytes
+ */
+typedef struct{
+  char name[COLUMN_NAMELEN + 1]; // null terminated
+  uint32_t type; // enum columnType
+  uint32_t pad;
+  uint64_t offset; // start of the values from the start of the file
+  uint64_t reserved;
+} columnDesc;
+
+/*
+ * A column file mapped for reading
+ */
+typedef struct{
+  size_t rows;
+  int ncols;
+  const columnDesc *cols; // descriptors, in the mapping
+  void *map;
+  size_t mapLen;
+} columnFile;
+
+/*
+ * A column file being written
+ */
+typedef struct{
+  int fd;
+  size_t rows;
+  int ncols;
+  columnDesc *cols;
+} columnWriter;
+
+/*
+ * Returns 1 if the file at path starts like a column file
+ */
+int columnsSniff(const char *path);
+
+/*
+ * Maps the column file at path
+ * Returns NULL if it can't be read or isn't a valid column file
+ */
+columnFile* columnsOpen(const char *path);
+
+/*
+ * Returns the index of the column called name, or -1 if there is none
+ */
+int columnFind(const columnFile *file, const char *name);
+
+/*
+ * Returns the values of column col, which are aligned to 64 bytes
+ */
+const void* columnData(const columnFile *file, int col);
+
+/*
+ * Unmaps a file returned by columnsOpen
+ */
+void columnsClose(columnFile *file);
+
+/*
+ * Creates a column file at path with rows rows and the given columns, all of
+ * them zero, replacing any file there
+ * Returns NULL if the file can't be created or a name is too long
+ */
+columnWriter* columnsCreate(const char *path, size_t rows, int ncols,
+    const char *const *names, const uint32_t *types);
+
+/*
+ * Writes count values of column col starting at row; may be called from
+ * several threads at once
+ * Returns 0 on success
+ */
+int columnsWrite(columnWriter *w, int col, size_t row, const void *values,
+    size_t count);
+
+/*
+ * Closes a file returned by columnsCreate
+ * Returns 0 if everything was written
+ */
+int columnsFinish(columnWriter *w);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
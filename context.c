@@ -0,0 +1,167 @@
+/*
+ * Conversions through a context owning all the state they depend on
+ */
+
+#include "context.h"
+#include "marsBatch.h"
+#include "marsNow.h"
+
+/*
+ * Creates a context with the newer of the built in leap table and leapfile,
+ * and the built in zones plus those in zonefile; either file may be NULL
+ * The default zone is Curiosity's (MSL)
+ */
+marsContext* marsContextNew(const char *leapfile, const char *zonefile){
+  marsContext *ctx = malloc(sizeof(marsContext));
+  if(ctx == NULL){
+    printf("Unable to alloc context\n");
+    exit(1);
+  }
+  ctx->leap = leapSourceOpen(leapfile);
+  ctx->zones = getZoneRegistryFile(zonefile);
+  ctx->zone = &curiosity;
+  ctx->ephem = NULL;
+  return ctx;
+}
+
+/*
+ * Reloads the leap table whenever its file changes, see leapSourceWatch
+ * Returns nonzero if the file can't be watched
+ */
+int marsContextWatch(marsContext *ctx){
+  return leapSourceWatch(ctx->leap);
+}
+
+/*
+ * Builds an ephemeris cache over [start, end] (J2K) with error at most tol
+ * degrees for Ls_r and EOT_r; must be called before the context is shared
+ * Returns nonzero if the cache can't be built
+ */
+int marsContextCache(marsContext *ctx, double start, double end, double tol){
+  ephemCache *cache = ephemBuild(start, end, tol);
+  if(cache == NULL)
+    return 1;
+  ephemFree(ctx->ephem);
+  ctx->ephem = cache;
+  return 0;
+}
+
+/*
+ * Releases the context and everything it owns, including a zone registry
+ * read from a file
+ */
+void marsContextFree(marsContext *ctx){
+  if(ctx == NULL)
+    return;
+  leapSourceClose(ctx->leap);
+  zoneRegistryFree(ctx->zones);
+  ephemFree(ctx->ephem);
+  free(ctx);
+}
+
+/*
+ * Returns the zone with the given epoch name, or NULL
+ */
+const timeZone* findZone_r(marsContext *ctx, const char *name){
+  return findZone(ctx->zones, name);
+}
+
+/*
+ * Returns TAI in Unix time, see UTCtoTAI
+ */
+long UTCtoTAI_r(marsContext *ctx, long time){
+  leapGuard guard;
+  long tai = UTCtoTAI(time, leapAcquire(ctx->leap, &guard));
+  leapRelease(&guard);
+  return tai;
+}
+
+/*
+ * Returns UTC in Unix time given TAI in Unix time, see TAItoUTC
+ */
+long TAItoUTC_r(marsContext *ctx, long tai){
+  leapGuard guard;
+  long utc = TAItoUTC(tai, leapAcquire(ctx->leap, &guard));
+  leapRelease(&guard);
+  return utc;
+}
+
+/*
+ * Converts UTC seconds since the Unix epoch and microseconds to Mars Sol Date
+ */
+double UTCtoMSD_r(marsContext *ctx, int64_t sec, int32_t usec){
+  double msd;
+  UTCtoMSD_batch_r(ctx, &sec, &usec, &msd, 1);
+  return msd;
+}
+
+/*
+ * Converts Mars Sol Date to a UTC timeval struct
+ * Returns out
+ */
+struct timeval* MSDtoUTC_r(marsContext *ctx, double MSD, struct timeval *out){
+  leapGuard guard;
+  MSDtoUTCstruct(MSD, leapAcquire(ctx->leap, &guard), out);
+  leapRelease(&guard);
+  return out;
+}
+
+/*
+ * Converts UTC to a sol date in tz (NULL for the default zone)
+ * Returns out
+ */
+soldate* UTCtoSoldate_r(marsContext *ctx, int64_t sec, int32_t usec,
+    const timeZone *tz, soldate *out){
+  return MSDtoSoldate_r(UTCtoMSD_r(ctx, sec, usec),
+      tz != NULL ? tz : ctx->zone, out);
+}
+
+/*
+ * Returns the current Mars Sol Date, see marsNow
+ */
+double marsNow_r(marsContext *ctx){
+  leapGuard guard;
+  double msd = marsNow(leapAcquire(ctx->leap, &guard));
+  leapRelease(&guard);
+  return msd;
+}
+
+/*
+ * Returns areocentric solar longitude (degrees), from the cache if the
+ * context has one
+ */
+double Ls_r(marsContext *ctx, double J2K){
+  if(ctx->ephem != NULL)
+    return ephemLs(ctx->ephem, J2K);
+  return computeOrbit(J2K).Ls;
+}
+
+/*
+ * Returns the equation of time (degrees), from the cache if the context has
+ * one
+ */
+double EOT_r(marsContext *ctx, double J2K){
+  if(ctx->ephem != NULL)
+    return ephemEOT(ctx->ephem, J2K);
+  return computeOrbit(J2K).EOT;
+}
+
+/*
+ * See UTCtoMSD_batch; the whole batch uses one leap table
+ */
+void UTCtoMSD_batch_r(marsContext *ctx, const int64_t *utc_sec,
+    const int32_t *usec, double *msd, size_t n){
+  leapGuard guard;
+  UTCtoMSD_batch(utc_sec, usec, msd, n, leapAcquire(ctx->leap, &guard));
+  leapRelease(&guard);
+}
+
+/*
+ * See MSDtoUTC_batch; the whole batch uses one leap table
+ */
+void MSDtoUTC_batch_r(marsContext *ctx, const double *msd, int64_t *utc_sec,
+    int32_t *usec, size_t n){
+  leapGuard guard;
+  MSDtoUTC_batch(msd, utc_sec, usec, n, leapAcquire(ctx->leap, &guard));
+  leapRelease(&guard);
+}
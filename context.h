@@ -0,0 +1,129 @@
+/*
+ * Conversions through a context owning all the state they depend on
+ *
+ * A marsContext holds the leap second source, the zone registry and an
+ * optional ephemeris cache. Nothing in it changes after it is set up except
+ * the leap table, which is replaced atomically (see leapSource.h), so one
+ * context can be shared by any number of threads. The _r functions below are
+ * the context versions of the library functions that need a leap table, a
+ * zone or a cache; the remaining functions are pure and reentrant as they
+ * are.
+ */
+
+#ifndef marscontext
+#define marscontext
+
+#include <stddef.h>
+#include <stdint.h>
+#include "marsTime.h"
+#include "leapSource.h"
+#include "zones.h"
+#include "ephemeris.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * State shared by the conversions, see marsContextNew
+ */
+typedef struct{
+  leapSource *leap;
+  const zoneRegistry *zones;
+  const timeZone *zone; // zone used when NULL is passed for one
+  ephemCache *ephem; // Ls and EOT cache, NULL to use computeOrbit
+} marsContext;
+
+/*
+ * Creates a context with the newer of the built in leap table and leapfile,
+ * and the built in zones plus those in zonefile; either file may be NULL
+ * The default zone is Curiosity's (MSL)
+ */
+marsContext* marsContextNew(const char *leapfile, const char *zonefile);
+
+/*
+ * Reloads the leap table whenever its file changes, see leapSourceWatch
+ * Returns nonzero if the file can't be watched
+ */
+int marsContextWatch(marsContext *ctx);
+
+/*
+ * Builds an ephemeris cache over [start, end] (J2K) with error at most tol
+ * degrees for Ls_r and EOT_r; must be called before the context is shared
+ * Returns nonzero if the cache can't be built
+ */
+int marsContextCache(marsContext *ctx, double start, double end, double tol);
+
+/*
+ * Releases the context and everything it owns, including a zone registry
+ * read from a file
+ */
+void marsContextFree(marsContext *ctx);
+
+/*
+ * Returns the zone with the given epoch name, or NULL
+ */
+const timeZone* findZone_r(marsContext *ctx, const char *name);
+
+/*
+ * Returns TAI in Unix time, see UTCtoTAI
+ */
+long UTCtoTAI_r(marsContext *ctx, long time);
+
+/*
+ * Returns UTC in Unix time given TAI in Unix time, see TAItoUTC
+ */
+long TAItoUTC_r(marsContext *ctx, long tai);
+
+/*
+ * Converts UTC seconds since the Unix epoch and microseconds to Mars Sol Date
+ */
+double UTCtoMSD_r(marsContext *ctx, int64_t sec, int32_t usec);
+
+/*
+ * Converts Mars Sol Date to a UTC timeval struct
+ * Returns out
+ */
+struct timeval* MSDtoUTC_r(marsContext *ctx, double MSD, struct timeval *out);
+
+/*
+ * Converts UTC to a sol date in tz (NULL for the default zone)
+ * Returns out
+ */
+soldate* UTCtoSoldate_r(marsContext *ctx, int64_t sec, int32_t usec,
+    const timeZone *tz, soldate *out);
+
+/*
+ * Returns the current Mars Sol Date, see marsNow
+ */
+double marsNow_r(marsContext *ctx);
+
+/*
+ * Returns areocentric solar longitude (degrees), from the cache if the
+ * context has one
+ */
+double Ls_r(marsContext *ctx, double J2K);
+
+/*
+ * Returns the equation of time (degrees), from the cache if the context has
+ * one
+ */
+double EOT_r(marsContext *ctx, double J2K);
+
+/*
+ * See UTCtoMSD_batch; the whole batch uses one leap table
+ */
+void UTCtoMSD_batch_r(marsContext *ctx, const int64_t *utc_sec,
+    const int32_t *usec, double *msd, size_t n);
+
+/*
+ * See MSDtoUTC_batch; the whole batch uses one leap table
+ */
+void MSDtoUTC_batch_r(marsContext *ctx, const double *msd, int64_t *utc_sec,
+    int32_t *usec, size_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
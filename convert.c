@@ -0,0 +1,307 @@
+/*
+ * Conversion of whole timestamp files through memory mappings
+ */
+
+#include <stdio.h>
+#include <stdatomic.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "convert.h"
+#include "marsBatch.h"
+#include "columns.h"
+#include "ephemeris.h"
+#include "parallel.h"
+
+// rows converted at a time by one thread
+#define CHUNK (1 << 16)
+// largest error of the fitted Ls and EOT (degrees), well below what the
+// output can show
+#define EPHEM_TOL 1e-7
+// rows sampled to place the fit, and rows per day of fitted range; a day
+// costs about as much to fit as a few rows cost to evaluate directly
+#define EPHEM_SAMPLES 4096
+#define EPHEM_ROWS_PER_DAY 64
+
+/*
+ * Converts a file of native int64 UTC timestamps (seconds since the Unix
+ * epoch) into a file of native double Mars Sol Dates in the same order,
+ * using the given number of threads (0 for one per CPU)
+ * Both files are memory-mapped, the output is written in place
+ * Returns 0 on success
+ */
+int convertFile(const char *in, const char *out, leapTable *table,
+    int threads){
+  int infd = open(in, O_RDONLY);
+  if(infd < 0){
+    printf("Cannot open file \"%s\"\n", in);
+    return 1;
+  }
+  struct stat st;
+  if(fstat(infd, &st) != 0 || st.st_size % sizeof(int64_t) != 0){
+    printf("\"%s\" is not a file of 64 bit timestamps\n", in);
+    close(infd);
+    return 1;
+  }
+  size_t n = st.st_size / sizeof(int64_t);
+
+  int outfd = open(out, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if(outfd < 0){
+    printf("Cannot open file \"%s\"\n", out);
+    close(infd);
+    return 1;
+  }
+  if(n == 0){
+    close(infd);
+    close(outfd);
+    return 0;
+  }
+  if(ftruncate(outfd, n * sizeof(double)) != 0){
+    printf("Cannot resize \"%s\"\n", out);
+    close(infd);
+    close(outfd);
+    return 1;
+  }
+
+  int err = 1;
+  const int64_t *utc = mmap(NULL, n * sizeof(int64_t), PROT_READ, MAP_SHARED,
+      infd, 0);
+  double *msd = mmap(NULL, n * sizeof(double), PROT_READ | PROT_WRITE,
+      MAP_SHARED, outfd, 0);
+  if(utc != MAP_FAILED && msd != MAP_FAILED){
+    madvise((void *)utc, n * sizeof(int64_t), MADV_SEQUENTIAL);
+    UTCtoMSD_parallel(utc, NULL, msd, n, table, threads);
+    err = 0;
+  }
+  else
+    printf("Cannot map \"%s\" or \"%s\"\n", in, out);
+  if(utc != MAP_FAILED)
+    munmap((void *)utc, n * sizeof(int64_t));
+  if(msd != MAP_FAILED)
+    munmap(msd, n * sizeof(double));
+  close(infd);
+  if(close(outfd) != 0)
+    err = 1;
+  return err;
+}
+
+/*
+ * A column file conversion shared by the threads
+ */
+typedef struct{
+  const int64_t *utc;
+  const int64_t *usec; // NULL if the input has none
+  leapTable *table;
+  const zoneSet *set;
+  const ephemCache *ephem; // NULL to evaluate Ls and EOT directly
+  columnWriter *out;
+  atomic_int err;
+} columnJob;
+
+/*
+ * Converts rows [begin, end) of a columnJob and writes them out
+ */
+static void convertChunk(size_t begin, size_t end, void *arg){
+  columnJob *job = arg;
+  size_t n = end - begin;
+  double *msd = malloc(n * sizeof(double));
+  double *ls = malloc(n * sizeof(double));
+  double *eot = malloc(n * sizeof(double));
+  double *lmst = malloc(n * sizeof(double));
+  double *ltst = malloc(n * sizeof(double));
+  int64_t *sol = malloc(n * sizeof(int64_t));
+  if(msd == NULL || ls == NULL || eot == NULL || lmst == NULL ||
+      ltst == NULL || sol == NULL){
+    printf("Unable to alloc conversion buffers\n");
+    exit(1);
+  }
+  size_t i;
+  if(job->usec != NULL){
+    int32_t *usec = malloc(n * sizeof(int32_t));
+    if(usec == NULL){
+      printf("Unable to alloc conversion buffers\n");
+      exit(1);
+    }
+    for(i=0; i<n; i++)
+      usec[i] = job->usec[begin + i];
+    UTCtoMSD_batch(job->utc + begin, usec, msd, n, job->table);
+    free(usec);
+  }
+  else
+    UTCtoMSD_batch(job->utc + begin, NULL, msd, n, job->table);
+  for(i=0; i<n; i++){
+    double J2K = MSDtoJ2K(msd[i]);
+    double l;
+    const ephemCache *ephem = job->ephem;
+    if(ephem != NULL && J2K >= ephem->start && J2K <= ephem->end){
+      l = ephemLs(ephem, J2K);
+      eot[i] = ephemEOT(ephem, J2K);
+    }
+    else{
+      marsOrbitState s = computeOrbit(J2K);
+      l = s.Ls;
+      eot[i] = s.EOT;
+    }
+    l = fmod(l, 360);
+    ls[i] = l < 0 ? l + 360 : l;
+  }
+  int err = columnsWrite(job->out, 0, begin, msd, n) ||
+    columnsWrite(job->out, 1, begin, ls, n);
+
+  // the sol is split off once and each zone's offset added to the fraction,
+  // like convertAllZones
+  const zoneSet *set = job->set;
+  int z;
+  for(z=0; z<set->size && !err; z++){
+    for(i=0; i<n; i++){
+      double whole = floor(msd[i]);
+      double t = msd[i] - whole + set->offset[z];
+      double carry = floor(t);
+      t -= carry;
+      sol[i] = (int64_t)whole + (int64_t)carry - set->startsol[z];
+      lmst[i] = t * 86400;
+      double u = t + eot[i] / 360;
+      ltst[i] = (u - floor(u)) * 86400;
+    }
+    err = columnsWrite(job->out, 2 + 3*z, begin, sol, n) ||
+      columnsWrite(job->out, 3 + 3*z, begin, lmst, n) ||
+      columnsWrite(job->out, 4 + 3*z, begin, ltst, n);
+  }
+  if(err)
+    atomic_store(&job->err, 1);
+  free(msd);
+  free(ls);
+  free(eot);
+  free(lmst);
+  free(ltst);
+  free(sol);
+}
+
+/*
+ * Returns the int64 column called name of file, or NULL if there is none
+ */
+static const int64_t* int64Column(const columnFile *file, const char *name){
+  int col = columnFind(file, name);
+  if(col < 0 || file->cols[col].type != COLUMN_INT64)
+    return NULL;
+  return columnData(file, col);
+}
+
+/*
+ * Orders int64 values for qsort
+ */
+static int compareInt64(const void *a, const void *b){
+  int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+  return (x > y) - (x < y);
+}
+
+/*
+ * Fits Ls and EOT over the range holding most of the n timestamps of utc
+ * The range is placed from a sample so outliers don't stretch it, and is
+ * at most n / EPHEM_ROWS_PER_DAY days around the median so the fit stays
+ * cheap next to the conversion; rows outside it use computeOrbit
+ * Returns NULL if there are too few rows for a fit to pay off
+ */
+static ephemCache* fitInput(const int64_t *utc, size_t n){
+  if(n <= CHUNK)
+    return NULL;
+  size_t m = n < EPHEM_SAMPLES ? n : EPHEM_SAMPLES;
+  int64_t *sample = malloc(m * sizeof(int64_t));
+  if(sample == NULL){
+    printf("Unable to alloc timestamp sample\n");
+    exit(1);
+  }
+  size_t i;
+  for(i=0; i<m; i++)
+    sample[i] = utc[i * (n / m)];
+  qsort(sample, m, sizeof(int64_t), compareInt64);
+  // a day of margin covers the leap seconds and TT
+  double lo = TAItoJ2K(sample[m / 100]) - 1;
+  double hi = TAItoJ2K(sample[m - 1 - m / 100]) + 1;
+  double mid = TAItoJ2K(sample[m / 2]);
+  free(sample);
+  double half = (double)n / EPHEM_ROWS_PER_DAY / 2;
+  if(lo < mid - half)
+    lo = mid - half;
+  if(hi > mid + half)
+    hi = mid + half;
+  return ephemBuild(lo, hi, EPHEM_TOL);
+}
+
+/*
+ * Converts a column file (see columns.h) with an int64 column "utc" of UTC
+ * seconds since the Unix epoch, and optionally an int64 column "usec" of
+ * microseconds, into a column file with the columns
+ *   msd   Mars Sol Date (double)
+ *   ls    areocentric solar longitude, 0 to 360 degrees (double)
+ * and for each zone of set, named after its epoch
+ *   EPOCH_sol   sol number (int64)
+ *   EPOCH_lmst  mean solar seconds into the sol (double)
+ *   EPOCH_ltst  true solar seconds into the sol (double)
+ * The input is used in place from its mapping and the output is written a
+ * chunk at a time, using the given number of threads (0 for one per CPU)
+ * Returns 0 on success
+ */
+int convertColumns(const char *in, const char *out, leapTable *table,
+    const zoneSet *set, int threads){
+  columnFile *file = columnsOpen(in);
+  if(file == NULL){
+    printf("\"%s\" is not a valid column file\n", in);
+    return 1;
+  }
+  columnJob job = {.table = table, .set = set, .ephem = NULL};
+  job.utc = int64Column(file, "utc");
+  job.usec = int64Column(file, "usec");
+  atomic_init(&job.err, 0);
+  if(job.utc == NULL){
+    printf("\"%s\" has no int64 column \"utc\"\n", in);
+    columnsClose(file);
+    return 1;
+  }
+
+  int ncols = 2 + 3 * set->size;
+  char (*names)[COLUMN_NAMELEN + 1] = malloc(ncols * sizeof(*names));
+  const char **namep = malloc(ncols * sizeof(char *));
+  uint32_t *types = malloc(ncols * sizeof(uint32_t));
+  if(names == NULL || namep == NULL || types == NULL){
+    printf("Unable to alloc column names\n");
+    exit(1);
+  }
+  int i;
+  strcpy(names[0], "msd");
+  strcpy(names[1], "ls");
+  types[0] = types[1] = COLUMN_DOUBLE;
+  for(i=0; i<set->size; i++){
+    const char *epoch = set->zones[i]->epochName;
+    snprintf(names[2 + 3*i], COLUMN_NAMELEN + 1, "%s_sol", epoch);
+    snprintf(names[3 + 3*i], COLUMN_NAMELEN + 1, "%s_lmst", epoch);
+    snprintf(names[4 + 3*i], COLUMN_NAMELEN + 1, "%s_ltst", epoch);
+    types[2 + 3*i] = COLUMN_INT64;
+    types[3 + 3*i] = types[4 + 3*i] = COLUMN_DOUBLE;
+  }
+  for(i=0; i<ncols; i++)
+    namep[i] = names[i];
+  job.out = columnsCreate(out, file->rows, ncols, namep, types);
+  free(names);
+  free(namep);
+  free(types);
+  if(job.out == NULL){
+    columnsClose(file);
+    return 1;
+  }
+
+  // Ls and EOT come from a fit over most of the input when one pays off
+  size_t n = file->rows;
+  ephemCache *ephem = fitInput(job.utc, n);
+  job.ephem = ephem;
+  parallelFor(threads, n, CHUNK, convertChunk, &job);
+  ephemFree(ephem);
+  columnsClose(file);
+  int err = atomic_load(&job.err);
+  if(columnsFinish(job.out) != 0)
+    err = 1;
+  if(err)
+    printf("Cannot write file \"%s\"\n", out);
+  return err;
+}
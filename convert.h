@@ -0,0 +1,38 @@
+/*
+ * Conversion of whole timestamp files through memory mappings
+ */
+
+#ifndef marsconvert
+#define marsconvert
+
+#include "leapSecs.h"
+#include "zones.h"
+
+/*
+ * Converts a file of native int64 UTC timestamps (seconds since the Unix
+ * epoch) into a file of native double Mars Sol Dates in the same order,
+ * using the given number of threads (0 for one per CPU)
+ * Both files are memory-mapped, the output is written in place
+ * Returns 0 on success
+ */
+int convertFile(const char *in, const char *out, leapTable *table,
+    int threads);
+
+/*
+ * Converts a column file (see columns.h) with an int64 column "utc" of UTC
+ * seconds since the Unix epoch, and optionally an int64 column "usec" of
+ * microseconds, into a column file with the columns
+ *   msd   Mars Sol Date (double)
+ *   ls    areocentric solar longitude, 0 to 360 degrees (double)
+ * and for each zone of set, named after its epoch
+ *   EPOCH_sol   sol number (int64)
+ *   EPOCH_lmst  mean solar seconds into the sol (double)
+ *   EPOCH_ltst  true solar seconds into the sol (double)
+ * The input is used in place from its mapping and the output is written a
+ * chunk at a time, using the given number of threads (0 for one per CPU)
+ * Returns 0 on success
+ */
+int convertColumns(const char *in, const char *out, leapTable *table,
+    const zoneSet *set, int threads);
+
+#endif
@@ -0,0 +1,168 @@
+/*
+ * Darian calendar: years of 24 months since the telescopic epoch (1609)
+ */
+
+#include <pthread.h>
+#include "darian.h"
+#include "marsInline.h"
+
+// sols in a quarter (five 28 sol months and one 27 sol month)
+#define QUARTER_SOLS 167
+
+static const char *const monthNames[24] = {
+  "Sagittarius", "Dhanus", "Capricornus", "Makara", "Aquarius", "Kumbha",
+  "Pisces", "Mina", "Aries", "Mesha", "Taurus", "Rishabha",
+  "Gemini", "Mithuna", "Cancer", "Karka", "Leo", "Simha",
+  "Virgo", "Kanya", "Libra", "Tula", "Scorpius", "Vrishika"
+};
+
+// sols from the start of a cycle to the start of each of its years
+static int32_t yearStart[DARIAN_CYCLE_YEARS + 1];
+static pthread_once_t yearStartOnce = PTHREAD_ONCE_INIT;
+
+/*
+ * Returns the name of month (1-24), or "?" if there is no such month
+ */
+const char* darianMonthName(int month){
+  if(month < 1 || month > 24)
+    return "?";
+  return monthNames[month - 1];
+}
+
+/*
+ * Returns the number of sols in year (668 or 669)
+ */
+int darianYearLength(long year){
+  int leap = (year % 2 != 0 || year % 10 == 0) &&
+    (year % 100 != 0 || year % 1000 == 0);
+  return 668 + leap;
+}
+
+/*
+ * Fills in yearStart
+ */
+static void initYearStart(){
+  int y;
+  yearStart[0] = 0;
+  for(y=0; y<DARIAN_CYCLE_YEARS; y++)
+    yearStart[y+1] = yearStart[y] + darianYearLength(y);
+}
+
+/*
+ * Floor of a / b for b > 0
+ */
+static inline long floorDiv(long a, long b){
+  long q = a / b;
+  return q - (a % b < 0);
+}
+
+/*
+ * Converts a count of sols since the epoch to year, month and sol
+ * yearStart must be filled in
+ */
+static inline void solsToDarian(long sols, marsCalDate *out){
+  long cycle = floorDiv(sols, DARIAN_CYCLE_SOLS);
+  int32_t r = sols - cycle * DARIAN_CYCLE_SOLS;
+  // leap years are spread evenly enough that the estimate is at most one
+  // year off either way
+  int y = (int64_t)r * DARIAN_CYCLE_YEARS / DARIAN_CYCLE_SOLS;
+  if(yearStart[y] > r)
+    y--;
+  else if(yearStart[y+1] <= r)
+    y++;
+  int doy = r - yearStart[y];
+  int quarter = doy / QUARTER_SOLS;
+  int rem = doy - quarter * QUARTER_SOLS;
+  if(quarter == 4){
+    // leap sol at the end of the year
+    quarter = 3;
+    rem += QUARTER_SOLS;
+  }
+  int month = rem / 28;
+  out->year = cycle * DARIAN_CYCLE_YEARS + y;
+  out->month = quarter * 6 + month + 1;
+  out->sol = rem - month * 28 + 1;
+}
+
+/*
+ * Converts MSD to a Darian date, yearStart must be filled in
+ */
+static inline void toDarian(double MSD, const timeZone *tz, marsCalDate *out){
+  double whole = floor(MSD);
+  int secs;
+  long carry = splitSol_inline(MSD - whole, tz->offset/86400, &secs);
+  solsToDarian((long)whole + carry - DARIAN_EPOCH, out);
+  out->hour = secs / 3600;
+  out->min = secs / 60 % 60;
+  out->sec = secs % 60;
+  out->tz = tz;
+}
+
+/*
+ * Converts floating point MSD to broken down time representing a date on the
+ * Darian Calendar, using the time of day of tz (NULL for MTC); the start sol
+ * of tz is not used
+ * Returns out
+ */
+marsCalDate* MSDtoDarian_r(double MSD, const timeZone *tz, marsCalDate *out){
+  pthread_once(&yearStartOnce, initYearStart);
+  toDarian(MSD, tz != NULL ? tz : &MTC, out);
+  return out;
+}
+
+/*
+ * Converts floating point MSD to broken down time representing a date on the
+ * Darian Calendar, in MTC
+ */
+marsCalDate MSDtoDarian(double MSD){
+  marsCalDate date;
+  MSDtoDarian_r(MSD, &MTC, &date);
+  return date;
+}
+
+/*
+ * Converts a Darian date and time of day back to MSD, the inverse of
+ * MSDtoDarian_r
+ * Months and sols past the end of their year or month roll over
+ */
+double DarianToMSD(const marsCalDate *date){
+  pthread_once(&yearStartOnce, initYearStart);
+  long cycle = floorDiv(date->year, DARIAN_CYCLE_YEARS);
+  int y = date->year - cycle * DARIAN_CYCLE_YEARS;
+  int m = date->month - 1;
+  long sols = cycle * DARIAN_CYCLE_SOLS + yearStart[y] +
+    m / 6 * QUARTER_SOLS + m % 6 * 28 + date->sol - 1;
+  double offset = date->tz != NULL ? date->tz->offset : 0;
+  return sols + DARIAN_EPOCH +
+    ((date->hour * 60 + date->min) * 60 + date->sec - offset) / 86400;
+}
+
+/*
+ * Converts n MSDs to Darian dates, see MSDtoDarian_r
+ */
+void MSDtoDarian_batch(const double *msd, const timeZone *tz, marsCalDate *out,
+    size_t n){
+  pthread_once(&yearStartOnce, initYearStart);
+  if(tz == NULL)
+    tz = &MTC;
+  size_t i;
+  for(i=0; i<n; i++)
+    toDarian(msd[i], tz, &out[i]);
+}
+
+/*
+ * Writes the date to buf in the format
+ * YEAR MONTH SOL HH:MM:SS
+ * e.g. 214 Rishabha 13 15:37:52
+ * followed by the zone name of date->tz if it has one
+ * Returns the length of the string, or -1 if it does not fit in len bytes
+ */
+int darianFormat(char *buf, size_t len, const marsCalDate *date){
+  const char *zone = date->tz != NULL ? date->tz->zoneName : "";
+  int n = snprintf(buf, len, "%ld %s %d %02d:%02d:%02d%s%s", date->year,
+      darianMonthName(date->month), date->sol, date->hour, date->min,
+      date->sec, zone[0] != '\0' ? " " : "", zone);
+  if(n < 0 || (size_t)n >= len)
+    return -1;
+  return n;
+}
@@ -0,0 +1,78 @@
+/*
+ * Darian calendar: years of 24 months since the telescopic epoch (1609)
+ *
+ * Each year has four quarters of five 28 sol months and one 27 sol month;
+ * leap years add a sol to the end of the last month. Years that are odd or
+ * divisible by 10 are leap years, except those divisible by 100 but not by
+ * 1000, so every 1000 years hold the same 668591 sols. The sols before the
+ * start of each year of that cycle are tabulated once, which makes a
+ * conversion a division by the cycle length, an estimate of the year and one
+ * table probe.
+ */
+
+#ifndef darian
+#define darian
+
+#include <stddef.h>
+#include "marsTime.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// MSD of the first sol of year 0
+#define DARIAN_EPOCH -94129
+#define DARIAN_CYCLE_YEARS 1000
+#define DARIAN_CYCLE_SOLS 668591
+
+/*
+ * Returns the name of month (1-24), or "?" if there is no such month
+ */
+const char* darianMonthName(int month);
+
+/*
+ * Returns the number of sols in year (668 or 669)
+ */
+int darianYearLength(long year);
+
+/*
+ * Converts floating point MSD to broken down time representing a date on the
+ * Darian Calendar, using the time of day of tz (NULL for MTC); the start sol
+ * of tz is not used
+ * Returns out
+ */
+marsCalDate* MSDtoDarian_r(double MSD, const timeZone *tz, marsCalDate *out);
+
+/*
+ * Converts floating point MSD to broken down time representing a date on the
+ * Darian Calendar, in MTC
+ */
+marsCalDate MSDtoDarian(double MSD);
+
+/*
+ * Converts a Darian date and time of day back to MSD, the inverse of
+ * MSDtoDarian_r
+ * Months and sols past the end of their year or month roll over
+ */
+double DarianToMSD(const marsCalDate *date);
+
+/*
+ * Converts n MSDs to Darian dates, see MSDtoDarian_r
+ */
+void MSDtoDarian_batch(const double *msd, const timeZone *tz, marsCalDate *out,
+    size_t n);
+
+/*
+ * Writes the date to buf in the format
+ * YEAR MONTH SOL HH:MM:SS
+ * e.g. 214 Rishabha 13 15:37:52
+ * followed by the zone name of date->tz if it has one
+ * Returns the length of the string, or -1 if it does not fit in len bytes
+ */
+int darianFormat(char *buf, size_t len, const marsCalDate *date);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,288 @@
+/*
+ * Piecewise Chebyshev approximations of Ls and the equation of time
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "ephemeris.h"
+#include "marsTime.h"
+
+#define EPHEM_MAGIC "MTEPHEM1"
+#define EPHEM_DEGREE 10
+// first segment length tried and the shortest one allowed (days)
+#define EPHEM_SEGLEN 256.0
+#define EPHEM_MINSEGLEN (1.0/64)
+// check points per coefficient in each segment
+#define EPHEM_CHECKS 8
+
+/*
+ * Layout of the start of a cache file, the coefficients follow at
+ * the next multiple of 64 bytes
+ */
+typedef struct{
+  char magic[8];
+  uint32_t version;
+  uint32_t degree;
+  uint64_t nseg;
+  double start, end, segLen;
+  double maxErrLs, maxErrEOT;
+} ephemHeader;
+
+#define EPHEM_DATA ((sizeof(ephemHeader) + 63) & ~(size_t)63)
+
+/*
+ * Evaluates the Chebyshev series with n coefficients at x in [-1, 1]
+ * (Clenshaw's recurrence)
+ */
+static inline double chebyshev(const double *c, int n, double x){
+  double b1 = 0, b2 = 0;
+  double twoX = 2 * x;
+  int k;
+  for(k=n-1; k>=1; k--){
+    double b = twoX * b1 - b2 + c[k];
+    b2 = b1;
+    b1 = b;
+  }
+  return x * b1 - b2 + c[0];
+}
+
+/*
+ * Fits the series of one segment starting at t0 from the values at the
+ * Chebyshev nodes
+ */
+static void fitSegment(double t0, double segLen, int n, double *ls,
+    double *eot){
+  double fls[n], feot[n];
+  int j, k;
+  for(j=0; j<n; j++){
+    double x = cos(PI * (j + 0.5) / n);
+    marsOrbitState s = computeOrbit(t0 + (x + 1) / 2 * segLen);
+    fls[j] = s.Ls;
+    feot[j] = s.EOT;
+  }
+  for(k=0; k<n; k++){
+    double sumLs = 0, sumEOT = 0;
+    for(j=0; j<n; j++){
+      double w = cos(PI * k * (j + 0.5) / n);
+      sumLs += fls[j] * w;
+      sumEOT += feot[j] * w;
+    }
+    ls[k] = sumLs * 2 / n;
+    eot[k] = sumEOT * 2 / n;
+  }
+  ls[0] /= 2;
+  eot[0] /= 2;
+}
+
+/*
+ * Fits every segment of length segLen and measures the largest error
+ * Returns the coefficients, or NULL if the error exceeds tol
+ */
+static double* fitRange(ephemCache *cache, double segLen, double tol){
+  int n = cache->degree + 1;
+  long nseg = ceil((cache->end - cache->start) / segLen);
+  if(nseg < 1)
+    nseg = 1;
+  double *coef = malloc(nseg * 2 * n * sizeof(double));
+  if(coef == NULL){
+    printf("Unable to alloc ephemeris coefficients\n");
+    exit(1);
+  }
+  double errLs = 0, errEOT = 0;
+  long seg;
+  int j;
+  for(seg=0; seg<nseg; seg++){
+    double t0 = cache->start + seg * segLen;
+    double *ls = coef + seg * 2 * n;
+    double *eot = ls + n;
+    fitSegment(t0, segLen, n, ls, eot);
+    for(j=0; j<=EPHEM_CHECKS*n; j++){
+      double x = 2.0 * j / (EPHEM_CHECKS*n) - 1;
+      marsOrbitState s = computeOrbit(t0 + (x + 1) / 2 * segLen);
+      errLs = fmax(errLs, fabs(chebyshev(ls, n, x) - s.Ls));
+      errEOT = fmax(errEOT, fabs(chebyshev(eot, n, x) - s.EOT));
+    }
+    if(errLs > tol || errEOT > tol){
+      free(coef);
+      return NULL;
+    }
+  }
+  cache->segLen = segLen;
+  cache->nseg = nseg;
+  cache->maxErrLs = errLs;
+  cache->maxErrEOT = errEOT;
+  return coef;
+}
+
+/*
+ * Fits Ls and EOT over [start, end] (days since J2000) so that the error is
+ * at most tol degrees at 8 check points per coefficient in every segment
+ * Returns NULL if that cannot be reached
+ */
+ephemCache* ephemBuild(double start, double end, double tol){
+  if(!(end > start))
+    return NULL;
+  ephemCache *cache = malloc(sizeof(ephemCache));
+  if(cache == NULL){
+    printf("Unable to alloc ephemeris\n");
+    exit(1);
+  }
+  cache->start = start;
+  cache->end = end;
+  cache->degree = EPHEM_DEGREE;
+  cache->mapLen = 0;
+  double segLen;
+  double *coef = NULL;
+  for(segLen = EPHEM_SEGLEN; coef == NULL && segLen >= EPHEM_MINSEGLEN;
+      segLen /= 2)
+    coef = fitRange(cache, segLen, tol);
+  if(coef == NULL){
+    free(cache);
+    return NULL;
+  }
+  cache->coef = coef;
+  cache->map = coef;
+  return cache;
+}
+
+/*
+ * Returns the coefficients of the segment holding J2K and sets x to the
+ * position within it, or returns NULL if J2K is out of range
+ */
+static inline const double* segment(const ephemCache *cache, double J2K,
+    double *x){
+  double u = (J2K - cache->start) / cache->segLen;
+  if(!(u >= 0) || J2K > cache->end)
+    return NULL;
+  long seg = u;
+  if(seg >= cache->nseg)
+    seg = cache->nseg - 1;
+  *x = 2 * (u - seg) - 1;
+  return cache->coef + seg * 2 * (cache->degree + 1);
+}
+
+/*
+ * Returns areocentric solar longitude (degrees), the same as Ls(J2K)
+ * Falls back to computeOrbit outside the range of the cache
+ */
+double ephemLs(const ephemCache *cache, double J2K){
+  double x;
+  const double *c = segment(cache, J2K, &x);
+  if(c == NULL)
+    return computeOrbit(J2K).Ls;
+  return chebyshev(c, cache->degree + 1, x);
+}
+
+/*
+ * Returns the equation of time (degrees), the same as EOT(J2K)
+ * Falls back to computeOrbit outside the range of the cache
+ */
+double ephemEOT(const ephemCache *cache, double J2K){
+  double x;
+  const double *c = segment(cache, J2K, &x);
+  if(c == NULL)
+    return computeOrbit(J2K).EOT;
+  return chebyshev(c + cache->degree + 1, cache->degree + 1, x);
+}
+
+/*
+ * Writes the cache to a file that ephemMap can read
+ * The file uses the byte order of the machine writing it
+ * Returns 0 on success
+ */
+int ephemSave(const ephemCache *cache, const char *path){
+  ephemHeader h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, EPHEM_MAGIC, 8);
+  h.version = 1;
+  h.degree = cache->degree;
+  h.nseg = cache->nseg;
+  h.start = cache->start;
+  h.end = cache->end;
+  h.segLen = cache->segLen;
+  h.maxErrLs = cache->maxErrLs;
+  h.maxErrEOT = cache->maxErrEOT;
+
+  FILE *fp = fopen(path, "wb");
+  if(fp == NULL){
+    printf("Cannot open file \"%s\"\n", path);
+    return 1;
+  }
+  static const char pad[EPHEM_DATA] = {0};
+  size_t ncoef = cache->nseg * 2 * (cache->degree + 1);
+  int err = fwrite(&h, sizeof(h), 1, fp) != 1 ||
+    fwrite(pad, 1, EPHEM_DATA - sizeof(h), fp) != EPHEM_DATA - sizeof(h) ||
+    fwrite(cache->coef, sizeof(double), ncoef, fp) != ncoef;
+  if(fclose(fp) != 0)
+    err = 1;
+  return err;
+}
+
+/*
+ * Maps a file written by ephemSave
+ * Returns NULL if the file can't be read or isn't a consistent cache file
+ */
+ephemCache* ephemMap(const char *path){
+  int fd = open(path, O_RDONLY);
+  if(fd < 0)
+    return NULL;
+  struct stat st;
+  if(fstat(fd, &st) != 0 || (size_t)st.st_size < EPHEM_DATA){
+    close(fd);
+    return NULL;
+  }
+  void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if(map == MAP_FAILED)
+    return NULL;
+
+  // the header is untrusted: bound degree and nseg by the size of the file
+  // before multiplying them, and check that the segments cover the range
+  const ephemHeader *h = map;
+  size_t avail = (st.st_size - EPHEM_DATA) / sizeof(double);
+  if(memcmp(h->magic, EPHEM_MAGIC, 8) != 0 || h->version != 1 ||
+      h->degree > 64 || h->nseg == 0 ||
+      h->nseg > avail / (2 * (h->degree + 1)) ||
+      !isfinite(h->start) || !isfinite(h->end) || !(h->end > h->start) ||
+      !isfinite(h->segLen) || !(h->segLen > 0) ||
+      (h->end - h->start) / h->segLen > h->nseg){
+    munmap(map, st.st_size);
+    return NULL;
+  }
+
+  ephemCache *cache = malloc(sizeof(ephemCache));
+  if(cache == NULL){
+    printf("Unable to alloc ephemeris\n");
+    exit(1);
+  }
+  cache->start = h->start;
+  cache->end = h->end;
+  cache->segLen = h->segLen;
+  cache->degree = h->degree;
+  cache->nseg = h->nseg;
+  cache->maxErrLs = h->maxErrLs;
+  cache->maxErrEOT = h->maxErrEOT;
+  cache->coef = (const double *)((const char *)map + EPHEM_DATA);
+  cache->map = map;
+  cache->mapLen = st.st_size;
+  return cache;
+}
+
+/*
+ * Releases a cache returned by ephemBuild or ephemMap
+ */
+void ephemFree(ephemCache *cache){
+  if(cache == NULL)
+    return;
+  if(cache->mapLen > 0)
+    munmap(cache->map, cache->mapLen);
+  else
+    free(cache->map);
+  free(cache);
+}
@@ -0,0 +1,75 @@
+/*
+ * Piecewise Chebyshev approximations of Ls and the equation of time
+ *
+ * For long runs of evaluations over a fixed date range, Ls and EOT are
+ * sampled from computeOrbit once and fitted segment by segment, so that each
+ * later evaluation is a segment lookup and a short polynomial instead of the
+ * full B- and C-series. The fits can be saved to a file and mapped back in.
+ */
+
+#ifndef ephemeris
+#define ephemeris
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Fitted representation of Ls and EOT over [start, end] (days since J2000)
+ */
+typedef struct{
+  double start, end; // range covered (J2K)
+  double segLen; // length of one segment (days)
+  int degree; // degree of the polynomial in each segment
+  long nseg; // number of segments
+  double maxErrLs, maxErrEOT; // largest errors found when checking (deg)
+  const double *coef; // for each segment degree+1 coefficients of Ls, then EOT
+  void *map; // mapping or allocation holding coef
+  size_t mapLen; // length of the mapping, 0 if coef was malloc'd
+} ephemCache;
+
+/*
+ * Fits Ls and EOT over [start, end] (days since J2000) so that the error is
+ * at most tol degrees at 8 check points per coefficient in every segment
+ * Returns NULL if that cannot be reached
+ */
+ephemCache* ephemBuild(double start, double end, double tol);
+
+/*
+ * Returns areocentric solar longitude (degrees), the same as Ls(J2K)
+ * Falls back to computeOrbit outside the range of the cache
+ */
+double ephemLs(const ephemCache *cache, double J2K);
+
+/*
+ * Returns the equation of time (degrees), the same as EOT(J2K)
+ * Falls back to computeOrbit outside the range of the cache
+ */
+double ephemEOT(const ephemCache *cache, double J2K);
+
+/*
+ * Writes the cache to a file that ephemMap can read
+ * The file uses the byte order of the machine writing it
+ * Returns 0 on success
+ */
+int ephemSave(const ephemCache *cache, const char *path);
+
+/*
+ * Maps a file written by ephemSave
+ * Returns NULL if the file can't be read or isn't a consistent cache file
+ */
+ephemCache* ephemMap(const char *path);
+
+/*
+ * Releases a cache returned by ephemBuild or ephemMap
+ */
+void ephemFree(ephemCache *cache);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,113 @@
+/*
+ * Exact integer conversion from TAI to Mars Sol Date
+ */
+
+#include "fixedTime.h"
+
+// one sol in SI nanoseconds
+#define SOL_NS 88775244146880LL
+// TT - TAI in nanoseconds
+#define TT_TAI_NS 32184000000LL
+// TT in nanoseconds since the Unix epoch at J2000 + 4.5 days, where
+// Equation C-2 gives MSD 44796.0 - 0.0009626
+#define TT_EPOCH_NS (10962 * 86400 * 1000000000LL)
+// whole sol and picoseconds into it at TT_EPOCH_NS:
+// 0.9990374 sol = 88689789096864.213312 ns, rounded to the picosecond
+#define EPOCH_SOL 44795
+#define EPOCH_PS 88689789096864213LL
+// TAI in nanoseconds since the Unix epoch at TT_EPOCH_NS, as whole sols and
+// nanoseconds
+#define EPOCH_TAI_SOLS ((TT_EPOCH_NS - TT_TAI_NS) / SOL_NS)
+#define EPOCH_TAI_NS ((TT_EPOCH_NS - TT_TAI_NS) % SOL_NS)
+
+/*
+ * Returns TAI in nanoseconds since the Unix epoch given UTC in nanoseconds
+ */
+int64_t UTCtoTAI_ns(int64_t utc_ns, leapTable *table){
+  int64_t sec = utc_ns / 1000000000;
+  if(utc_ns % 1000000000 < 0)
+    sec--;
+  return utc_ns + offset(sec, table) * 1000000000LL;
+}
+
+/*
+ * Converts TAI in nanoseconds since the Unix epoch to Mars Sol Date
+ * Valid for the whole range of int64_t nanoseconds (1678 to 2262)
+ */
+marsFixed TAInsToFixed(int64_t tai_ns){
+  // split into sols before taking off the epoch, which would overflow
+  // tai_ns before 1708
+  int64_t q = tai_ns / SOL_NS;
+  int64_t r = tai_ns - q * SOL_NS;
+  // floor instead of truncating division, borrow for the epoch and carry
+  // the epoch offset into the next sol, all without branches (-1 masks from
+  // the sign bit)
+  int64_t neg = r >> 63;
+  r += neg & SOL_NS;
+  q += neg - EPOCH_TAI_SOLS;
+  r -= EPOCH_TAI_NS;
+  neg = r >> 63;
+  r += neg & SOL_NS;
+  q += neg;
+  int64_t ps = r * 1000 + EPOCH_PS - SOL_PS;
+  int64_t under = ps >> 63;
+  ps += under & SOL_PS;
+  q += 1 + under;
+  marsFixed msd = {q + EPOCH_SOL, ps};
+  return msd;
+}
+
+/*
+ * Converts n TAI times in nanoseconds since the Unix epoch to Mars Sol Dates
+ */
+void TAInsToFixed_batch(const int64_t *tai_ns, marsFixed *out, size_t n){
+  size_t i;
+  for(i=0; i<n; i++)
+    out[i] = TAInsToFixed(tai_ns[i]);
+}
+
+/*
+ * Converts a Mars Sol Date back to TAI in nanoseconds since the Unix epoch,
+ * rounded down
+ * Valid for every date TAInsToFixed returns
+ */
+int64_t fixedToTAIns(marsFixed msd){
+  int64_t ps = msd.ps - EPOCH_PS;
+  int64_t ns = ps / 1000;
+  if(ps % 1000 < 0)
+    ns--;
+  // the sols alone can be out of range next to the first and last
+  // representable times, so sum in wrapping unsigned arithmetic
+  uint64_t sols = msd.sol - EPOCH_SOL + EPOCH_TAI_SOLS;
+  return sols * SOL_NS + (uint64_t)(ns + EPOCH_TAI_NS);
+}
+
+/*
+ * Returns the Mars Sol Date as floating point sols
+ */
+double fixedToMSD(marsFixed msd){
+  return msd.sol + (double)msd.ps / SOL_PS;
+}
+
+/*
+ * Converts a Mars Sol Date to broken down time in the given time zone,
+ * stored in out
+ * Returns out
+ */
+soldate* fixedToSoldate_r(marsFixed msd, const timeZone *tz, soldate *out){
+  int64_t sol = msd.sol - tz->startsol;
+  int64_t ps = msd.ps + llround(tz->offset * MARS_SEC_PS);
+  int64_t q = ps / SOL_PS;
+  ps -= q * SOL_PS;
+  if(ps < 0){
+    ps += SOL_PS;
+    q--;
+  }
+  int sec = ps / MARS_SEC_PS;
+  out->sol = sol + q;
+  out->hour = sec / 3600;
+  out->min = sec / 60 % 60;
+  out->sec = sec % 60;
+  out->tz = tz;
+  return out;
+}
@@ -0,0 +1,76 @@
+/*
+ * Exact integer conversion from TAI to Mars Sol Date
+ *
+ * A sol is exactly 86400 * 1.0274912517 = 88775.24414688 SI seconds, so a
+ * sol is a whole number of nanoseconds and the whole chain from nanoseconds
+ * of TAI to sols can be done in integers. Times within a sol are kept in
+ * picoseconds, in which a Martian second is exact and the 0.0009626 sol
+ * offset of Equation C-2 is rounded by under a picosecond. Results are the
+ * same on every machine.
+ */
+
+#ifndef fixedtime
+#define fixedtime
+
+#include <stddef.h>
+#include <stdint.h>
+#include "marsTime.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// one Martian second in SI picoseconds
+#define MARS_SEC_PS 1027491251700LL
+// one sol in SI picoseconds
+#define SOL_PS (86400 * MARS_SEC_PS)
+
+/*
+ * Mars Sol Date as a whole sol number and the SI picoseconds elapsed since the
+ * start of that sol (0 <= ps < SOL_PS), i.e. MSD = sol + ps / SOL_PS
+ */
+typedef struct{
+  int64_t sol;
+  int64_t ps;
+} marsFixed;
+
+/*
+ * Returns TAI in nanoseconds since the Unix epoch given UTC in nanoseconds
+ */
+int64_t UTCtoTAI_ns(int64_t utc_ns, leapTable *table);
+
+/*
+ * Converts TAI in nanoseconds since the Unix epoch to Mars Sol Date
+ * Valid for the whole range of int64_t nanoseconds (1678 to 2262)
+ */
+marsFixed TAInsToFixed(int64_t tai_ns);
+
+/*
+ * Converts n TAI times in nanoseconds since the Unix epoch to Mars Sol Dates
+ */
+void TAInsToFixed_batch(const int64_t *tai_ns, marsFixed *out, size_t n);
+
+/*
+ * Converts a Mars Sol Date back to TAI in nanoseconds since the Unix epoch,
+ * rounded down
+ * Valid for every date TAInsToFixed returns
+ */
+int64_t fixedToTAIns(marsFixed msd);
+
+/*
+ * Returns the Mars Sol Date as floating point sols
+ */
+double fixedToMSD(marsFixed msd);
+
+/*
+ * Converts a Mars Sol Date to broken down time in the given time zone,
+ * stored in out
+ * Returns out
+ */
+soldate* fixedToSoldate_r(marsFixed msd, const timeZone *tz, soldate *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
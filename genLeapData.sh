@@ -0,0 +1,35 @@
+#!/bin/sh
+# generates the C header holding the leap second table compiled into marsTime
+# from the file maintained by update.sh
+# usage: genLeapData.sh leap-seconds > leapData.h
+
+awk '
+function unix(ntp){ return sprintf("%.0f", ntp - 2208988800) }
+BEGIN { n = 0 }
+/^#\$/ { updated = $2 }
+/^#@/ { expires = $2 }
+/^[0-9]/ { times[n] = $1; offsets[n] = $2; n++ }
+END {
+  if(n == 0){
+    print "no leap second entries found" > "/dev/stderr"
+    exit 1
+  }
+  print "/*"
+  print " * Leap second table generated from " FILENAME " by genLeapData.sh"
+  print " * Do not edit, run make after updating " FILENAME " instead"
+  print " */"
+  print ""
+  print "#define LEAP_UPDATED " unix(updated) "L"
+  print "#define LEAP_EXPIRES " unix(expires) "L"
+  print "#define LEAP_SIZE " n
+  print ""
+  print "static const int64_t leapTimes[LEAP_SIZE] __attribute__((aligned(64))) = {"
+  for(i = 0; i < n; i++)
+    print "  " unix(times[i]) "L" (i < n-1 ? "," : "")
+  print "};"
+  print ""
+  print "static const int32_t leapOffsets[LEAP_SIZE] __attribute__((aligned(64))) = {"
+  for(i = 0; i < n; i++)
+    print "  " offsets[i] (i < n-1 ? "," : "")
+  print "};"
+}' "${1:-leap-seconds}"
@@ -2,7 +2,12 @@
  * Determines difference between UTC and TAI using file downloaded from NIST
  */
 
+#include <stdatomic.h>
 #include "leapSecs.h"
+#include "leapData.h"
+
+// conversions done past the expiry of their leap table
+static atomic_ulong expiredCount;
 
 /* int main(int argc, char* argv[]){ */
 /*   leapTable *table = malloc(sizeof(leapTable)); */
@@ -33,74 +38,112 @@
 /*   return 0; */
 /* } */
 
+/*
+ * Returns the leap second table compiled into the program from the bundled
+ * leap-seconds file, unless MARSTIME_LEAPFILE names a file with a newer table
+ */
 leapTable* getLeapTable(){
-  leapTable *table = malloc(sizeof(table));
-  if(table == NULL)
+  return getLeapTableFile(getenv("MARSTIME_LEAPFILE"));
+}
+
+/*
+ * Returns the compiled in leap second table, or the table in filename if
+ * that one was updated more recently
+ * filename may be NULL or empty to skip the file
+ */
+leapTable* getLeapTableFile(char *filename){
+  static leapTable builtin = {
+    .updated = LEAP_UPDATED,
+    .expires = LEAP_EXPIRES,
+    .size = LEAP_SIZE,
+    .times = leapTimes,
+    .offsets = leapOffsets
+  };
+  if(filename == NULL || filename[0] == '\0')
+    return &builtin;
+
+  leapTable *table = calloc(1, sizeof(leapTable));
+  if(table == NULL){
+    fprintf(stderr, "Unable to alloc table\n");
     exit(1);
-  parseFile("/home/stephan/.marsTime/leap-seconds", table);
+  }
+  if(parseFile(filename, table) != 0 || table->updated <= builtin.updated){
+    // parseFile leaves times and offsets NULL if it fails
+    free((int64_t *)table->times);
+    free((int32_t *)table->offsets);
+    free(table);
+    return &builtin;
+  }
   return table;
 }
 
+/*
+ * reads the file and stores the leap second info in the provided struct
+ * returns 0 on success, nonzero if the file is unreadable or has no entries,
+ * in which case the table is left empty with NULL arrays
+ * errors are reported on stderr so they don't mix with converted output
+ */
 int parseFile(char *filename, leapTable *table){
-  /*wordexp_t p = malloc(sizeof(wordexp_t));*/
-  /*wordexp(filename, pV*/
+  table->size = 0;
+  table->times = NULL;
+  table->offsets = NULL;
   FILE *fp = fopen(filename, "r");
   if(fp == NULL){
-    printf("Cannot open file \"%s\"\n", filename);
-    exit(1);
+    fprintf(stderr, "Cannot open file \"%s\"\n", filename);
+    return 1;
   }
 
   int size = 0; // number of leap second entries
-  int arraySize = 1; // number of spaces in arrays to store entries
-  table->times = malloc(arraySize*sizeof(double));
-  if(table->times == NULL){
-    printf("Unable to alloc times\n");
-    exit(1);
-  }
-
-  table->offsets = malloc(arraySize*sizeof(int));
-  if(table->offsets == NULL){
-    printf("Unable to alloc offsets\n");
+  int arraySize = 32; // number of spaces in arrays to store entries
+  int64_t *times = malloc(arraySize*sizeof(*times));
+  int32_t *offsets = malloc(arraySize*sizeof(*offsets));
+  if(times == NULL || offsets == NULL){
+    fprintf(stderr, "Unable to alloc leap second table\n");
     exit(1);
   }
+  table->updated = 0;
+  table->expires = 0;
 
-  
-
-  char *buffer = malloc(30*sizeof(char));
-  char *eoftest;
-  eoftest = fgets(buffer, 30, fp);
-  while(eoftest != NULL){
-    //    printf("%s\n", eoftest);
+  char buffer[256];
+  while(fgets(buffer, sizeof(buffer), fp) != NULL){
+    if(strchr(buffer, '\n') == NULL){
+      // skip the rest of overlong (comment) lines
+      int c;
+      while((c = fgetc(fp)) != EOF && c != '\n');
+    }
     if(buffer[0] == '#'){
-      if(buffer[1] == '$'){
-	buffer = &buffer[2];
-	//	dest = &(leapSecs->updated);
-	sscanf(buffer, "%ld", &(table->updated));
-	table->updated = ntp2unix(table->updated);
-      }
-      else if(buffer[1] == '@'){
-	buffer = &buffer[2];
-	//	dest = &(leapSecs->expires);
-	sscanf(buffer, "%ld", &(table->expires));
-	table->expires = ntp2unix(table->expires);
-      }
-      //      sscanf(buffer, "%d", dest);
-  //      *dest = ntp2unix(*dest);
+      if(buffer[1] == '$')
+        table->updated = ntp2unix(strtoll(buffer+2, NULL, 10));
+      else if(buffer[1] == '@')
+        table->expires = ntp2unix(strtoll(buffer+2, NULL, 10));
     }
     else if(buffer[0]>='0' && buffer[0]<='9'){
-      size++;
-      if(size>arraySize){
-	arraySize *= 2;
-	table->times = realloc(table->times, arraySize*sizeof(double));
-	table->offsets = realloc(table->offsets, arraySize*sizeof(int));
+      if(size == arraySize){
+        arraySize *= 2;
+        times = realloc(times, arraySize*sizeof(*times));
+        offsets = realloc(offsets, arraySize*sizeof(*offsets));
+        if(times == NULL || offsets == NULL){
+          fprintf(stderr, "Unable to alloc leap second table\n");
+          exit(1);
+        }
       }
-      sscanf(buffer, "%ld %d", &table->times[size-1], &table->offsets[size-1]);
-      table->times[size-1] = ntp2unix(table->times[size-1]);
+      char *end;
+      times[size] = ntp2unix(strtoll(buffer, &end, 10));
+      offsets[size] = strtol(end, NULL, 10);
+      size++;
     }
-    eoftest = fgets(buffer, 30, fp);
+  }
+  fclose(fp);
+
+  if(size == 0){
+    fprintf(stderr, "No leap seconds found in \"%s\"\n", filename);
+    free(times);
+    free(offsets);
+    return 1;
   }
   table->size = size;
-  //fclose(fp);
+  table->times = times;
+  table->offsets = offsets;
   return 0;
 }
 
@@ -115,61 +158,219 @@ double ntp2unix(double ntptime){
   Returns a pointer to an ISO8601 formatted string of the given date
 */
 char* timestr(time_t time){
-  char *str = malloc(20*sizeof(char));
-  char *format = "%F %T %z";
-  strftime(str, 20, format, gmtime(&time));
-  return str;
+  char *str = malloc(32*sizeof(char));
+  if(str == NULL){
+    printf("Unable to alloc time string\n");
+    exit(1);
+  }
+  return timestr_r(time, str, 32);
+}
+
+/*
+ * Writes time as UTC in the format 2012-07-01 00:00:00 +0000 to buf, which
+ * should hold at least 26 bytes
+ * Returns buf
+ */
+char* timestr_r(time_t time, char *buf, size_t len){
+  struct tm tm;
+  if(len == 0)
+    return buf;
+  if(gmtime_r(&time, &tm) == NULL || strftime(buf, len, "%F %T %z", &tm) == 0)
+    buf[0] = '\0';
+  return buf;
+}
+
+/*
+ * Returns the index of the last of the size sorted times that is <= time, or
+ * -1 if there is none
+ * The loop has a fixed trip count for a given size and compiles to
+ * conditional moves, so it costs the same whether or not it is predictable
+ */
+static int leapSearch(const int64_t *times, int size, long time){
+  const int64_t *base = times;
+  int n = size;
+  while(n > 1){
+    int half = n / 2;
+    base = base[half] <= time ? base + half : base;
+    n -= half;
+  }
+  return (base - times) + (*base <= time) - 1;
 }
 
 /*
  * Returns TAI-UTC at the given UTC time
- * This is only valid from 1972 until the expiration of the file
- * (usually 6-12 months in the future)
+ * Before 1972 this is the 1972 offset of 10 s, after the table expires it is
+ * the last known offset; use leapRange to tell these cases apart
  */
 int offset(long time, leapTable *table){
-  if(time < table->times[0]){
-    // out of range, no leap seconds yet
+  int i = leapSearch(table->times, table->size, time);
+  if(i < 0){
+    // out of range, no leap seconds yet: UTC used fractional offsets and
+    // rate changes before 1972, 10 s is only the closest whole number
+    return table->offsets[0];
+  }
+  // past table->expires the last offset is kept, leap seconds announced
+  // since the table was published are missing
+  return table->offsets[i];
+}
+
+/*
+ * Returns the enum leapRange the given UTC time falls in
+ */
+int leapRange(long time, leapTable *table){
+  if(time < table->times[0])
+    return LEAP_BEFORE;
+  if(time >= table->expires)
+    return LEAP_EXPIRED;
+  return LEAP_VALID;
+}
+
+/*
+ * Points the cursor at the start of the table
+ */
+void leapCursorInit(leapCursor *cursor, leapTable *table){
+  cursor->table = table;
+  leapCursorSeek(cursor, INT64_MIN);
+}
+
+/*
+ * Moves the cursor to the segment containing the given UTC time
+ */
+void leapCursorSeek(leapCursor *cursor, long time){
+  leapTable *table = cursor->table;
+  int last = table->size - 1;
+  int i = leapSearch(table->times, table->size, time);
+  cursor->index = i;
+  if(i < 0){
+    cursor->start = INT64_MIN;
+    cursor->next = table->times[0];
+    cursor->offset = table->offsets[0];
+    cursor->range = LEAP_BEFORE;
+    return;
   }
-  else if(time > table->expires){
-    // out of range, leap seconds unknown
+  cursor->offset = table->offsets[i];
+  cursor->start = table->times[i];
+  cursor->next = i < last ? table->times[i+1] : INT64_MAX;
+  cursor->range = LEAP_VALID;
+  // the expiry splits the segment it falls in
+  if(table->expires < cursor->next && table->expires > cursor->start){
+    if(time < table->expires)
+      cursor->next = table->expires;
+    else
+      cursor->start = table->expires;
   }
-  if(time >= table->times[table->size-1])
-    return table->offsets[table->size-1];
-  int low = 0;
-  int high = table->size-1;
-  int mid = (low+high)/2;
-  while(high > low+1){
-    if(time == table->times[mid])
-      break;
-    else if(time > table->times[mid]){
-      low = mid;
-    }
+  if(time >= table->expires)
+    cursor->range = LEAP_EXPIRED;
+}
+
+/*
+ * Points the cursor at the start of the table, for lookups by TAI
+ */
+void leapCursorInitTAI(leapCursor *cursor, leapTable *table){
+  cursor->table = table;
+  leapCursorSeekTAI(cursor, INT64_MIN);
+}
+
+/*
+ * Moves the cursor to the segment containing the given TAI time
+ * Segments run from the TAI time of one entry to that of the next, so an
+ * inserted leap second belongs to the segment before it, like in TAItoUTC
+ */
+void leapCursorSeekTAI(leapCursor *cursor, long tai){
+  leapTable *table = cursor->table;
+  int last = table->size - 1;
+  int i = leapIndexTAI(tai, table);
+  cursor->index = i;
+  if(i < 0){
+    cursor->start = INT64_MIN;
+    cursor->next = table->times[0] + table->offsets[0];
+    cursor->offset = table->offsets[0];
+    cursor->range = LEAP_BEFORE;
+    return;
+  }
+  cursor->offset = table->offsets[i];
+  cursor->start = table->times[i] + table->offsets[i];
+  cursor->next = i < last ? table->times[i+1] + table->offsets[i+1] :
+    INT64_MAX;
+  cursor->range = LEAP_VALID;
+  int64_t expires = table->expires + table->offsets[i];
+  if(expires < cursor->next && expires > cursor->start){
+    if(tai < expires)
+      cursor->next = expires;
     else
-      high = mid;
-    mid = (low + high) / 2;
+      cursor->start = expires;
   }
-  return table->offsets[mid];
+  if(tai >= expires)
+    cursor->range = LEAP_EXPIRED;
 }
 
 /*
  * Returns TAI in Unix time 
  * (actual seconds since 1970-01-01 00:00:00 TAI, including leap seconds)
  */
-int UTCtoTAI(long time, leapTable *table){
+long UTCtoTAI(long time, leapTable *table){
+  if(time >= table->expires)
+    leapCountExpired(1);
   return time + offset(time, table);
 }
 
 /*
- * Returns seconds since the epoch, given a string representing a date
+ * Adds n to the count of conversions done past the expiry of their table
  */
-time_t getdateint(char *string){
-  struct tm *time = malloc(sizeof(struct tm));
-  time_t unixtime;
-  if(time == NULL)
-    exit(1);
-  time = getdate(string);
-  unixtime = mktime(time);
-  free(time);
-  return unixtime;
+void leapCountExpired(unsigned long n){
+  atomic_fetch_add_explicit(&expiredCount, n, memory_order_relaxed);
 }
 
+/*
+ * Returns the number of conversions done past the expiry of their table, by
+ * UTCtoTAI and the batch conversions, since the program started
+ */
+unsigned long leapExpiredCount(){
+  return atomic_load_explicit(&expiredCount, memory_order_relaxed);
+}
+
+/*
+ * Releases a table returned by getLeapTableFile, unless it is the built in
+ * one
+ */
+void freeLeapTable(leapTable *table){
+  if(table == NULL || table->times == leapTimes)
+    return;
+  free((int64_t *)table->times);
+  free((int32_t *)table->offsets);
+  free(table);
+}
+
+/*
+ * Returns the index of the table entry in effect at the given UTC time, or -1
+ * if the time is before the first entry
+ */
+int leapIndex(long time, leapTable *table){
+  return leapSearch(table->times, table->size, time);
+}
+
+/*
+ * Returns the index of the table entry in effect at the given TAI time, or -1
+ * if the time is before the first entry
+ */
+int leapIndexTAI(long tai, leapTable *table){
+  int low = 0;
+  int high = table->size;
+  while(low < high){
+    int mid = (low + high) / 2;
+    if(table->times[mid] + table->offsets[mid] <= tai)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+  return low - 1;
+}
+
+/*
+ * Returns UTC in Unix time given TAI in Unix time format
+ * The inserted leap second itself maps onto the first second after it
+ */
+long TAItoUTC(long tai, leapTable *table){
+  int i = leapIndexTAI(tai, table);
+  return tai - table->offsets[i < 0 ? 0 : i];
+}
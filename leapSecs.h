@@ -12,20 +12,62 @@
 #ifndef leapSecs
 #define leapSecs
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /*int main(int argc, char* argv[]);*/
 
 typedef struct{
-  long updated; // when the current list was updated
-  long expires; // when the current list expires
+  int64_t updated; // when the current list was updated
+  int64_t expires; // when the current list expires
   int size; // number of time offset pairs
-  long *times; // second after leap seconds are applied (UTC)
-  int *offsets; // TAI-UTC starting at that time
+  const int64_t *times; // second after leap seconds are applied (UTC)
+  const int32_t *offsets; // TAI-UTC starting at that time
 } leapTable;
 
+/*
+ * Where a time falls relative to the range covered by a leap table
+ */
+enum leapRange{
+  LEAP_BEFORE = -1, // before the first entry (1972), TAI-UTC was not whole
+  LEAP_VALID = 0,
+  LEAP_EXPIRED = 1 // after the table expires, later leap seconds unknown
+};
+
+/*
+ * Remembers the leap second segment found by the last lookup so that lookups
+ * of nearby times (e.g. a sorted stream of timestamps) skip the search
+ * The segment covers the UTC seconds in [start, next), or the TAI seconds in
+ * [start, next) for a cursor set up with leapCursorInitTAI
+ */
+typedef struct{
+  leapTable *table;
+  int64_t start; // first second of the current segment
+  int64_t next; // first second after the current segment
+  int offset; // TAI-UTC during the current segment
+  int index; // table entry of the current segment, -1 before the first
+  int range; // enum leapRange of the current segment
+} leapCursor;
+
+/*
+ * Returns the leap second table compiled into the program from the bundled
+ * leap-seconds file, unless MARSTIME_LEAPFILE names a file with a newer table
+ */
 leapTable* getLeapTable();
 
+/*
+ * Returns the compiled in leap second table, or the table in filename if
+ * that one was updated more recently
+ * filename may be NULL or empty to skip the file
+ */
+leapTable* getLeapTableFile(char *filename);
+
 /*
  * reads the file and stores the leap second info in the provided struct
+ * returns 0 on success, nonzero if the file is unreadable or has no entries,
+ * in which case the table is left empty with NULL arrays
+ * errors are reported on stderr so they don't mix with converted output
  */
 int parseFile(char *filename, leapTable* table);
 
@@ -38,14 +80,118 @@ int getOffset(double time);
 
 double ntp2unix(double ntptime);
 
+/*
+ * Returns time as UTC in the format 2012-07-01 00:00:00 +0000
+ * The string is malloc'd and must be freed by the caller
+ */
 char* timestr(time_t time);
 
+/*
+ * Writes time as UTC in the format 2012-07-01 00:00:00 +0000 to buf, which
+ * should hold at least 26 bytes
+ * Returns buf
+ */
+char* timestr_r(time_t time, char *buf, size_t len);
+
+/*
+ * Returns TAI-UTC at the given UTC time
+ * Before 1972 this is the 1972 offset of 10 s, after the table expires it is
+ * the last known offset; use leapRange to tell these cases apart
+ */
 int offset(long time, leapTable *table);
 
+/*
+ * Returns the enum leapRange the given UTC time falls in
+ */
+int leapRange(long time, leapTable *table);
+
+/*
+ * Points the cursor at the start of the table
+ */
+void leapCursorInit(leapCursor *cursor, leapTable *table);
+
+/*
+ * Moves the cursor to the segment containing the given UTC time
+ */
+void leapCursorSeek(leapCursor *cursor, long time);
+
+/*
+ * Returns TAI-UTC at the given UTC time, the same as offset(), searching the
+ * table only if the time is outside the segment of the previous lookup
+ * cursor->range tells whether the time was covered by the table
+ */
+static inline int leapCursorOffset(leapCursor *cursor, long time){
+  if(__builtin_expect((uint64_t)time - (uint64_t)cursor->start >=
+        (uint64_t)cursor->next - (uint64_t)cursor->start, 0))
+    leapCursorSeek(cursor, time);
+  return cursor->offset;
+}
+
+/*
+ * Points the cursor at the start of the table, for lookups by TAI
+ */
+void leapCursorInitTAI(leapCursor *cursor, leapTable *table);
+
+/*
+ * Moves the cursor to the segment containing the given TAI time
+ */
+void leapCursorSeekTAI(leapCursor *cursor, long tai);
+
+/*
+ * Returns TAI-UTC at the given TAI time, the same as the offset TAItoUTC
+ * subtracts, searching the table only if the time is outside the segment of
+ * the previous lookup
+ */
+static inline int leapCursorOffsetTAI(leapCursor *cursor, long tai){
+  if(__builtin_expect((uint64_t)tai - (uint64_t)cursor->start >=
+        (uint64_t)cursor->next - (uint64_t)cursor->start, 0))
+    leapCursorSeekTAI(cursor, tai);
+  return cursor->offset;
+}
+
 /*
  * Returns TAI in Unix time format
  * (actual seconds since 1970-01-01 00:00:00 TAI, including leap seconds)
  */
-int UTCtoTAI(long time, leapTable *table);
+long UTCtoTAI(long time, leapTable *table);
+
+/*
+ * Adds n to the count of conversions done past the expiry of their table
+ */
+void leapCountExpired(unsigned long n);
+
+/*
+ * Returns the number of conversions done past the expiry of their table, by
+ * UTCtoTAI and the batch conversions, since the program started
+ */
+unsigned long leapExpiredCount();
+
+/*
+ * Releases a table returned by getLeapTableFile, unless it is the built in
+ * one
+ */
+void freeLeapTable(leapTable *table);
+
+/*
+ * Returns the index of the table entry in effect at the given UTC time, or -1
+ * if the time is before the first entry
+ */
+int leapIndex(long time, leapTable *table);
+
+/*
+ * Returns the index of the table entry in effect at the given TAI time, or -1
+ * if the time is before the first entry
+ */
+int leapIndexTAI(long tai, leapTable *table);
+
+/*
+ * Returns UTC in Unix time given TAI in Unix time format
+ * The inserted leap second itself maps onto the first second after it
+ */
+long TAItoUTC(long tai, leapTable *table);
  
+#ifdef __cplusplus
+}
+#endif
+
 #endif
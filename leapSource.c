@@ -0,0 +1,227 @@
+/*
+ * Leap second table that is reloaded while the program runs
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <libgen.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "leapSource.h"
+
+// reader slots, threads beyond this many share them
+#define LEAP_SLOTS 64
+
+/*
+ * Readers active in each epoch parity, padded to a cache line
+ */
+typedef struct leapSlot{
+  atomic_long active[2];
+  char pad[64 - 2 * sizeof(atomic_long)];
+} leapSlot;
+
+struct leapSource{
+  _Atomic(leapTable *) current;
+  atomic_ulong epoch; // flipped each time the table is replaced
+  atomic_ulong reloads; // number of times the table was replaced
+  char *path; // file the table is read from, NULL for the built in table
+  int inotifyfd; // -1 when not watching
+  int stopfd; // eventfd that stops the watcher
+  pthread_t watcher;
+  pthread_mutex_t writer; // serializes replacements, readers never take it
+  leapSlot slots[LEAP_SLOTS];
+};
+
+// slot of the calling thread, LEAP_SLOTS until it first reads
+static __thread unsigned slotIndex = LEAP_SLOTS;
+static atomic_uint nextSlot;
+
+/*
+ * Creates a source holding the newer of the built in table and the table in
+ * path (NULL for the built in table only)
+ */
+leapSource* leapSourceOpen(const char *path){
+  leapSource *src;
+  if(posix_memalign((void **)&src, 64, sizeof(leapSource)) != 0){
+    printf("Unable to alloc leap source\n");
+    exit(1);
+  }
+  memset(src, 0, sizeof(leapSource));
+  src->path = path != NULL && path[0] != '\0' ? strdup(path) : NULL;
+  src->inotifyfd = -1;
+  src->stopfd = -1;
+  pthread_mutex_init(&src->writer, NULL);
+  atomic_init(&src->current, getLeapTableFile(src->path));
+  return src;
+}
+
+/*
+ * Returns the current table, which stays valid until leapRelease is called
+ * with the same guard
+ * Never blocks; sections of one thread may nest
+ */
+leapTable* leapAcquire(leapSource *src, leapGuard *guard){
+  if(__builtin_expect(slotIndex == LEAP_SLOTS, 0))
+    slotIndex = atomic_fetch_add_explicit(&nextSlot, 1,
+        memory_order_relaxed) % LEAP_SLOTS;
+  leapSlot *slot = &src->slots[slotIndex];
+  for(;;){
+    unsigned long e = atomic_load(&src->epoch);
+    atomic_fetch_add(&slot->active[e & 1], 1);
+    // if the epoch flipped in between, the writer may have checked this
+    // parity already; back out and use the new one
+    if(atomic_load(&src->epoch) == e){
+      guard->slot = slot;
+      guard->parity = e & 1;
+      return atomic_load(&src->current);
+    }
+    atomic_fetch_sub(&slot->active[e & 1], 1);
+  }
+}
+
+/*
+ * Ends a section started by leapAcquire
+ */
+void leapRelease(leapGuard *guard){
+  atomic_fetch_sub_explicit(&guard->slot->active[guard->parity], 1,
+      memory_order_release);
+}
+
+/*
+ * Waits until every reader that may have loaded the table published before
+ * the last epoch flip has released it
+ */
+static void waitForReaders(leapSource *src, int parity){
+  int i;
+  for(i=0; i<LEAP_SLOTS; i++)
+    while(atomic_load(&src->slots[i].active[parity]) != 0){
+      struct timespec ts = {0, 50000};
+      nanosleep(&ts, NULL);
+    }
+}
+
+/*
+ * Reads the file again and publishes its table if it is newer than the
+ * current one
+ * Returns 1 if the table was replaced, 0 if not
+ */
+int leapSourceReload(leapSource *src){
+  if(src->path == NULL)
+    return 0;
+  leapTable *table = getLeapTableFile(src->path);
+  pthread_mutex_lock(&src->writer);
+  leapTable *old = atomic_load(&src->current);
+  if(table->updated <= old->updated){
+    pthread_mutex_unlock(&src->writer);
+    freeLeapTable(table);
+    return 0;
+  }
+  atomic_store(&src->current, table);
+  unsigned long e = atomic_fetch_add(&src->epoch, 1);
+  waitForReaders(src, e & 1);
+  atomic_fetch_add_explicit(&src->reloads, 1, memory_order_relaxed);
+  pthread_mutex_unlock(&src->writer);
+  freeLeapTable(old);
+  return 1;
+}
+
+/*
+ * Returns how many times the table has been replaced since the source was
+ * opened
+ */
+unsigned long leapSourceReloads(leapSource *src){
+  return atomic_load_explicit(&src->reloads, memory_order_relaxed);
+}
+
+/*
+ * Reloads the table after each write to or rename onto its file
+ */
+static void* leapWatcher(void *p){
+  leapSource *src = p;
+  char *copy = strdup(src->path);
+  const char *name = basename(copy);
+  char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+  struct pollfd fds[2] = {
+    {.fd = src->inotifyfd, .events = POLLIN},
+    {.fd = src->stopfd, .events = POLLIN}
+  };
+  for(;;){
+    if(poll(fds, 2, -1) < 0){
+      if(errno == EINTR)
+        continue;
+      break;
+    }
+    if(fds[1].revents != 0)
+      break;
+    ssize_t n = read(src->inotifyfd, buf, sizeof(buf));
+    if(n <= 0)
+      continue;
+    int changed = 0;
+    char *ev;
+    for(ev = buf; ev < buf + n;
+        ev += sizeof(struct inotify_event) + ((struct inotify_event *)ev)->len){
+      struct inotify_event *event = (struct inotify_event *)ev;
+      if(event->len > 0 && strcmp(event->name, name) == 0)
+        changed = 1;
+    }
+    if(changed)
+      leapSourceReload(src);
+  }
+  free(copy);
+  return NULL;
+}
+
+/*
+ * Starts a thread that reloads the table whenever its file is written or
+ * replaced
+ * Returns nonzero if the file can't be watched
+ */
+int leapSourceWatch(leapSource *src){
+  if(src->path == NULL || src->inotifyfd >= 0)
+    return src->path == NULL;
+  // watch the directory, update.sh and editors may replace the file
+  char *copy = strdup(src->path);
+  const char *dir = dirname(copy);
+  src->inotifyfd = inotify_init1(IN_CLOEXEC);
+  src->stopfd = eventfd(0, EFD_CLOEXEC);
+  int err = src->inotifyfd < 0 || src->stopfd < 0 ||
+    inotify_add_watch(src->inotifyfd, dir, IN_CLOSE_WRITE | IN_MOVED_TO) < 0 ||
+    pthread_create(&src->watcher, NULL, leapWatcher, src) != 0;
+  free(copy);
+  if(err){
+    printf("Cannot watch \"%s\"\n", src->path);
+    if(src->inotifyfd >= 0)
+      close(src->inotifyfd);
+    if(src->stopfd >= 0)
+      close(src->stopfd);
+    src->inotifyfd = -1;
+    src->stopfd = -1;
+    return 1;
+  }
+  return 0;
+}
+
+/*
+ * Stops the watcher and releases the source and its table
+ * No reader may be using it any more
+ */
+void leapSourceClose(leapSource *src){
+  if(src == NULL)
+    return;
+  if(src->inotifyfd >= 0){
+    uint64_t one = 1;
+    if(write(src->stopfd, &one, sizeof(one)) == sizeof(one))
+      pthread_join(src->watcher, NULL);
+    close(src->inotifyfd);
+    close(src->stopfd);
+  }
+  freeLeapTable(atomic_load(&src->current));
+  pthread_mutex_destroy(&src->writer);
+  free(src->path);
+  free(src);
+}
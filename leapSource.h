@@ -0,0 +1,83 @@
+/*
+ * Leap second table that is reloaded while the program runs
+ *
+ * The current table is published through an atomic pointer. Readers mark
+ * themselves active in one of a fixed set of slots, tagged with the parity of
+ * a global epoch, and never take a lock. To replace the table the writer
+ * swaps the pointer, flips the epoch and waits until no reader is left in
+ * the old parity before freeing the old table. A watcher thread uses inotify
+ * to notice when the file is rewritten (e.g. by update.sh) and reloads it.
+ */
+
+#ifndef leapsource
+#define leapsource
+
+#include "leapSecs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Published leap table, see leapSourceOpen; the layout is private to
+ * leapSource.c so the header needs no C11 atomics
+ */
+typedef struct leapSource leapSource;
+
+/*
+ * Read side critical section, filled in by leapAcquire
+ */
+typedef struct{
+  struct leapSlot *slot;
+  int parity;
+} leapGuard;
+
+/*
+ * Creates a source holding the newer of the built in table and the table in
+ * path (NULL for the built in table only)
+ */
+leapSource* leapSourceOpen(const char *path);
+
+/*
+ * Starts a thread that reloads the table whenever its file is written or
+ * replaced
+ * Returns nonzero if the file can't be watched
+ */
+int leapSourceWatch(leapSource *src);
+
+/*
+ * Reads the file again and publishes its table if it is newer than the
+ * current one
+ * Returns 1 if the table was replaced, 0 if not
+ */
+int leapSourceReload(leapSource *src);
+
+/*
+ * Returns how many times the table has been replaced since the source was
+ * opened
+ */
+unsigned long leapSourceReloads(leapSource *src);
+
+/*
+ * Returns the current table, which stays valid until leapRelease is called
+ * with the same guard
+ * Never blocks; sections of one thread may nest
+ */
+leapTable* leapAcquire(leapSource *src, leapGuard *guard);
+
+/*
+ * Ends a section started by leapAcquire
+ */
+void leapRelease(leapGuard *guard);
+
+/*
+ * Stops the watcher and releases the source and its table
+ * No reader may be using it any more
+ */
+void leapSourceClose(leapSource *src);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,47 @@
+/*
+ * Public header of libmarstime, conversions between Terran and Martian time
+ *
+ * Includes every header of the library. MARSTIME_VERSION_* give the version
+ * of the headers and marstimeVersion() that of the library linked in; the
+ * shared library's soname changes with the major version.
+ */
+
+#ifndef libmarstime
+#define libmarstime
+
+#define MARSTIME_VERSION_MAJOR 1
+#define MARSTIME_VERSION_MINOR 0
+#define MARSTIME_VERSION_PATCH 0
+#define MARSTIME_VERSION "1.0.0"
+#define MARSTIME_VERSION_NUMBER (MARSTIME_VERSION_MAJOR * 10000 + \
+    MARSTIME_VERSION_MINOR * 100 + MARSTIME_VERSION_PATCH)
+
+#include "marsTime.h"
+#include "marsInline.h"
+#include "leapSecs.h"
+#include "leapSource.h"
+#include "timestamp.h"
+#include "zones.h"
+#include "darian.h"
+#include "fixedTime.h"
+#include "marsBatch.h"
+#include "marsNow.h"
+#include "ephemeris.h"
+#include "context.h"
+#include "columns.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Returns MARSTIME_VERSION_NUMBER of the library, to check that it matches
+ * the headers a program was compiled with
+ */
+int marstimeVersion();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
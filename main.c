@@ -5,26 +5,293 @@
  * 2012-08-03
  */
 
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
 #include "marsTime.h"
+#include "stream.h"
+#include "raster.h"
+#include "convert.h"
+#include "columns.h"
+#include "zones.h"
+#include "darian.h"
+#include "server.h"
+#include "watch.h"
+#include "marsNow.h"
+#include "timestamp.h"
 
-/*extern timeZone MTC;*/
+/*
+ * Prints the command line options
+ */
+static void usage(char *name){
+  printf("Usage: %s [OPTIONS]\n"
+         "Prints the current time in a Mars time zone, or:\n", name);
+  printf("  --leap-file FILE  use FILE if it is newer than the built in leap seconds\n");
+  printf("  --zones FILE      read more time zones from FILE\n");
+  printf("  --zone NAME       show sol dates in the zone with epoch NAME (default MSL)\n");
+  printf("  --all-zones       show the current time in every zone\n");
+  printf("  --darian          show the current Darian calendar date\n");
+  printf("  --at WHEN         show the time at WHEN instead of now, an ISO-8601 or\n"
+         "                    RFC 3339 date or Unix seconds (UTC unless given)\n");
+  printf("  --watch [min]     keep showing the time, updated every Martian second\n"
+         "                    (or minute), in the zone or with --all-zones\n");
+  printf("  --utc WHEN        convert WHEN, an MSD or a sol date like\n"
+         "                    \"MSL 5046 15:37:52\", to UTC\n");
+  printf("  --stream [FILE]   convert UTC timestamps read line by line from FILE or\n"
+         "                    standard input instead of the current time\n");
+  printf("  --raster FILE     write global solar elevation and azimuth grids to FILE\n");
+  printf("    --res DEG       grid cell size (default 0.1)\n");
+  printf("    --count N       number of grids (default 1)\n");
+  printf("    --step SECONDS  time between grids (default 3600)\n");
+  printf("  --convert IN OUT  convert a file of int64 UTC seconds to a file of\n"
+         "                    double MSDs, or a column file with a \"utc\" column\n"
+         "                    to one with MSD, Ls and the time in the zone (or\n"
+         "                    --all-zones), see columns.h\n");
+  printf("  --serve SOCK      answer binary conversion requests on the Unix socket\n"
+         "                    SOCK, see server.h\n");
+  printf("  --threads N       threads to use (default one per CPU)\n");
+}
+
+/*
+ * Converts str, either an MSD or EPOCH SOL HH:MM[:SS] in a zone of registry,
+ * to UTC and prints it in ISO-8601 format
+ */
+static int printUTC(char *str, const zoneRegistry *registry,
+    leapTable *leaptable){
+  double msd;
+  char *end;
+  msd = strtod(str, &end);
+  if(end == str || *end != '\0'){
+    char epoch[32];
+    soldate date;
+    date.sec = 0;
+    // used is the length matched, with or without the seconds
+    int used = 0;
+    if(sscanf(str, "%31s %ld %d:%d%n:%d%n", epoch, &date.sol, &date.hour,
+          &date.min, &used, &date.sec, &used) < 4 || str[used] != '\0' ||
+        date.hour < 0 || date.hour > 23 || date.min < 0 || date.min > 59 ||
+        date.sec < 0 || date.sec > 59 ||
+        (date.tz = findZone(registry, epoch)) == NULL){
+      printf("Cannot parse \"%s\"\n", str);
+      return 1;
+    }
+    msd = soldateToMSD(&date);
+  }
+  struct timeval tv;
+  MSDtoUTCstruct(msd, leaptable, &tv);
+  struct tm tm;
+  time_t sec = tv.tv_sec;
+  gmtime_r(&sec, &tm);
+  char buf[64];
+  strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &tm);
+  printf("%s.%06ldZ\n", buf, (long)tv.tv_usec);
+  return 0;
+}
+
+/*
+ * Converts timestamps from a file or standard input, see streamConvert
+ */
+static int runStream(char *path, leapTable *leaptable, const timeZone *tz){
+  int fd = 0;
+  if(path != NULL && strcmp(path, "-") != 0){
+    fd = open(path, O_RDONLY);
+    if(fd < 0){
+      printf("Cannot open file \"%s\"\n", path);
+      return 1;
+    }
+  }
+  streamStats stats;
+  int err = streamConvert(fd, 1, leaptable, tz, &stats);
+  if(fd != 0)
+    close(fd);
+  if(err){
+    fprintf(stderr, "marsTime: read or write error\n");
+    return 1;
+  }
+  double secs = stats.seconds > 0 ? stats.seconds : 1e-9;
+  if(leapExpiredCount() > 0)
+    fprintf(stderr, "marsTime: warning: %lu timestamps after the leap second "
+        "table expired, later leap seconds are missing\n", leapExpiredCount());
+  fprintf(stderr, "marsTime: %llu lines (%llu invalid) in %.3f s, "
+      "%.2f M lines/s, %.1f MB/s in\n",
+      (unsigned long long)stats.lines, (unsigned long long)stats.invalid,
+      stats.seconds, stats.lines / secs / 1e6, stats.bytesIn / secs / 1e6);
+  return 0;
+}
 
 int main(int argc, char *argv[]){
-  leapTable *leaptable = getLeapTable();
-  initDefs();
-  struct timeval tv; // = malloc(sizeof(struct timeval));
-  gettimeofday(&tv, NULL);
-  double tai = UTCstructToTAIfloat(&tv, leaptable);
-  /*double tai = UTCtoTAI(1211759632, leaptable);*/
-  /*printf("TAI=%lf\n", tai);*/
-  double j2k = TAItoJ2K(tai);
-  /*printf("J2000=%lf\n", j2k);*/
-  double msd = J2KtoMSD(j2k);
-  /*printf("MSD=%lf\n", msd);*/
-  soldate *marsdate = MSDtoSoldate(msd, &curiosity);
-  /*printf("Sol:%ld\nHr: %d\nMin:%d\nSec:%d\n", marsdate->sol, marsdate->hour, */
-  /*marsdate->min, marsdate->sec);*/
-  char *str = soldateToString(marsdate);
+  char *leapfile = getenv("MARSTIME_LEAPFILE");
+  char *zonefile = getenv("MARSTIME_ZONES");
+  char *zonename = "MSL";
+  int allzones = 0;
+  int showdarian = 0;
+  char *utcfrom = NULL;
+  char *at = NULL;
+  char *socketpath = NULL;
+  int watching = 0;
+  int streaming = 0;
+  char *streamfile = NULL;
+  char *rasterfile = NULL;
+  char *convertin = NULL, *convertout = NULL;
+  double res = 0.1;
+  double step = 3600;
+  int count = 1;
+  int threads = 0;
+  int i;
+  for(i=1; i<argc; i++){
+    if(strcmp(argv[i], "--leap-file") == 0 && i+1 < argc)
+      leapfile = argv[++i];
+    else if(strcmp(argv[i], "--zones") == 0 && i+1 < argc)
+      zonefile = argv[++i];
+    else if(strcmp(argv[i], "--zone") == 0 && i+1 < argc)
+      zonename = argv[++i];
+    else if(strcmp(argv[i], "--all-zones") == 0)
+      allzones = 1;
+    else if(strcmp(argv[i], "--darian") == 0)
+      showdarian = 1;
+    else if(strcmp(argv[i], "--watch") == 0){
+      watching = 1;
+      if(i+1 < argc && strcmp(argv[i+1], "min") == 0){
+        watching = 2;
+        i++;
+      }
+    }
+    else if(strcmp(argv[i], "--serve") == 0 && i+1 < argc)
+      socketpath = argv[++i];
+    else if(strcmp(argv[i], "--at") == 0 && i+1 < argc)
+      at = argv[++i];
+    else if(strcmp(argv[i], "--utc") == 0 && i+1 < argc)
+      utcfrom = argv[++i];
+    else if(strcmp(argv[i], "--raster") == 0 && i+1 < argc)
+      rasterfile = argv[++i];
+    else if(strcmp(argv[i], "--convert") == 0 && i+2 < argc){
+      convertin = argv[++i];
+      convertout = argv[++i];
+    }
+    else if(strcmp(argv[i], "--res") == 0 && i+1 < argc)
+      res = atof(argv[++i]);
+    else if(strcmp(argv[i], "--step") == 0 && i+1 < argc)
+      step = atof(argv[++i]);
+    else if(strcmp(argv[i], "--count") == 0 && i+1 < argc)
+      count = atoi(argv[++i]);
+    else if(strcmp(argv[i], "--threads") == 0 && i+1 < argc)
+      threads = atoi(argv[++i]);
+    else if(strcmp(argv[i], "--stream") == 0){
+      streaming = 1;
+      if(i+1 < argc && strncmp(argv[i+1], "--", 2) != 0)
+        streamfile = argv[++i];
+    }
+    else{
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  leapTable *leaptable = getLeapTableFile(leapfile);
+  const zoneRegistry *registry = getZoneRegistryFile(zonefile);
+  const timeZone *tz = findZone(registry, zonename);
+  if(tz == NULL){
+    printf("Unknown zone \"%s\", known zones:", zonename);
+    for(i=0; i<registry->size; i++)
+      printf(" %s", registry->zones[i]->epochName);
+    printf("\n");
+    return 1;
+  }
+  if(socketpath != NULL){
+    // block the stop signals before any thread starts, so that the leap file
+    // watcher inherits the mask and only the sigwait in serveSocket sees them
+    sigset_t stop;
+    sigemptyset(&stop);
+    sigaddset(&stop, SIGINT);
+    sigaddset(&stop, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop, NULL);
+    // keep the leap table up to date while serving
+    leapSource *leap = leapSourceOpen(leapfile);
+    if(leapfile != NULL)
+      leapSourceWatch(leap);
+    return serveSocket(socketpath, leap, registry, threads);
+  }
+  if(watching){
+    zoneSet *set;
+    if(allzones)
+      set = makeZoneSet(registry);
+    else{
+      // a set holding just the selected zone
+      zoneRegistry one = {.size = 1, .zones = &tz};
+      set = makeZoneSet(&one);
+    }
+    int err = watchClock(set, leaptable, watching == 2);
+    freeZoneSet(set);
+    return err;
+  }
+  if(utcfrom != NULL)
+    return printUTC(utcfrom, registry, leaptable);
+  if(streaming)
+    return runStream(streamfile, leaptable, tz);
+  if(convertin != NULL){
+    if(!columnsSniff(convertin))
+      return convertFile(convertin, convertout, leaptable, threads);
+    zoneSet *set;
+    if(allzones)
+      set = makeZoneSet(registry);
+    else{
+      zoneRegistry one = {.size = 1, .zones = &tz};
+      set = makeZoneSet(&one);
+    }
+    int err = convertColumns(convertin, convertout, leaptable, set, threads);
+    freeZoneSet(set);
+    return err;
+  }
+  double msd;
+  if(at != NULL){
+    int64_t sec;
+    int32_t usec;
+    if(!parseTimestamp(at, strlen(at), &sec, &usec)){
+      printf("Cannot parse \"%s\"\n", at);
+      return 1;
+    }
+    msd = TAItoMSD(UTCtoTAI(sec, leaptable) + usec / 1e6);
+  }
+  else
+    msd = marsNow(leaptable);
+  double j2k = MSDtoJ2K(msd);
+  if(rasterfile != NULL){
+    if(res <= 0 || res > 90 || count <= 0){
+      usage(argv[0]);
+      return 1;
+    }
+    if(illumRaster(rasterfile, j2k, step, count, res, threads) != 0){
+      printf("Cannot write raster \"%s\"\n", rasterfile);
+      return 1;
+    }
+    return 0;
+  }
+  if(showdarian){
+    marsCalDate date;
+    MSDtoDarian_r(msd, &MTC, &date);
+    char str[64];
+    darianFormat(str, sizeof(str), &date);
+    printf("%s\n", str);
+    return 0;
+  }
+  if(allzones){
+    zoneSet *set = makeZoneSet(registry);
+    soldate dates[set->size];
+    convertAllZones(msd, set, dates);
+    for(i=0; i<set->size; i++){
+      char str[64];
+      soldateFormat(str, sizeof(str), &dates[i]);
+      printf("%s\n", str);
+    }
+    freeZoneSet(set);
+    return 0;
+  }
+  soldate marsdate;
+  MSDtoSoldate_r(msd, tz, &marsdate);
+  /*printf("Sol:%ld\nHr: %d\nMin:%d\nSec:%d\n", marsdate.sol, marsdate.hour, */
+  /*marsdate.min, marsdate.sec);*/
+  char str[64];
+  soldateFormat(str, sizeof(str), &marsdate);
   printf("%s\n", str);
   return 0;
 }
@@ -0,0 +1,250 @@
+/*
+ * Array versions of the UTC -> TAI -> J2000 -> MSD chain and its inverse
+ */
+
+#include <limits.h>
+#include "marsBatch.h"
+#include "marsSimd.h"
+#include "parallel.h"
+
+// SI seconds in one sol (86400 * 1.0274912517)
+#define SOL_SECS 88775.24414688
+// MSD at 1970-01-01 00:00:00 TT, from Equation C-2 (modified)
+#define MSD_UNIX (44796.0 - 0.0009626 - 10962.0/1.0274912517)
+// TAI in Unix time format at MSD 44796.0 - 0.0009626
+#define TAI_MSD0 (10962.0 * 86400 - 32.184)
+
+// number of MSDs converted to TAI at a time before splitting into seconds
+#define CHUNK 512
+// elements handed to a thread at a time by the parallel versions
+#define GRAIN (1 << 16)
+
+/*
+ * Converts one run of timestamps sharing the same TAI-UTC
+ */
+static void UTCrunToMSD(const int64_t *sec, const int32_t *usec, double *msd,
+    size_t n, double bias){
+  const double scale = 1 / SOL_SECS;
+  const double uscale = 1e-6 / SOL_SECS;
+  vdouble vscale = vset(scale);
+  vdouble vuscale = vset(uscale);
+  vdouble vbias = vset(bias);
+  size_t i = 0;
+  if(usec != NULL){
+    for(; i + SIMD_WIDTH <= n; i += SIMD_WIDTH)
+      vstore(msd+i, vfmadd(vloadi64(sec+i), vscale,
+            vfmadd(vloadi32(usec+i), vuscale, vbias)));
+    for(; i < n; i++)
+      msd[i] = sfmadd((double)sec[i], scale, sfmadd((double)usec[i], uscale, bias));
+  }
+  else{
+    for(; i + SIMD_WIDTH <= n; i += SIMD_WIDTH)
+      vstore(msd+i, vfmadd(vloadi64(sec+i), vscale, vbias));
+    for(; i < n; i++)
+      msd[i] = sfmadd((double)sec[i], scale, bias);
+  }
+}
+
+/*
+ * Converts n UTC timestamps (seconds since the Unix epoch plus microseconds)
+ * to floating point Mars Sol Dates
+ * usec may be NULL if all timestamps are whole seconds
+ * Equivalent to J2KtoMSD(TAItoJ2K(UTCtoTAI(...))) for each element
+ */
+void UTCtoMSD_batch(const int64_t *utc_sec, const int32_t *usec, double *msd,
+    size_t n, leapTable *table){
+  leapCursor cursor;
+  leapCursorInit(&cursor, table);
+  size_t i = 0;
+  while(i < n){
+    int off = leapCursorOffset(&cursor, utc_sec[i]);
+    int64_t start = cursor.start;
+    int64_t next = cursor.next;
+    size_t end = i + 1;
+    while(end < n && utc_sec[end] >= start && utc_sec[end] < next)
+      end++;
+    if(cursor.range == LEAP_EXPIRED)
+      leapCountExpired(end - i);
+    double bias = (off + 32.184) / SOL_SECS + MSD_UNIX;
+    UTCrunToMSD(utc_sec+i, usec == NULL ? NULL : usec+i, msd+i, end-i, bias);
+    i = end;
+  }
+}
+
+/*
+ * Splits one run of TAI times sharing the same TAI-UTC into UTC seconds and
+ * microseconds
+ */
+static void TAIrunToUTC(const double *tai, int64_t *sec, int32_t *usec,
+    size_t n, int off){
+  size_t i;
+  for(i=0; i<n; i++){
+    double utc = tai[i] - off;
+    double whole = floor(utc);
+    int64_t s = whole;
+    if(usec != NULL){
+      int32_t us = llround((utc - whole) * 1e6);
+      if(us >= 1000000){
+        us -= 1000000;
+        s++;
+      }
+      usec[i] = us;
+    }
+    sec[i] = s;
+  }
+}
+
+/*
+ * Converts n Mars Sol Dates back to UTC seconds since the Unix epoch and
+ * microseconds
+ * usec may be NULL if only whole seconds (rounded down) are wanted
+ */
+void MSDtoUTC_batch(const double *msd, int64_t *utc_sec, int32_t *usec,
+    size_t n, leapTable *table){
+  double tai[CHUNK];
+  vdouble vmsd0 = vset(44796.0 - 0.0009626);
+  vdouble vsol = vset(SOL_SECS);
+  vdouble vtai0 = vset(TAI_MSD0);
+  leapCursor cursor;
+  leapCursorInitTAI(&cursor, table);
+  // with microseconds, times are rounded to the microsecond before the leap
+  // second lookup like in MSDtoUTCstruct
+  double bias = usec != NULL ? 0.5e-6 : 0;
+  size_t base;
+  for(base = 0; base < n; base += CHUNK){
+    size_t len = n - base < CHUNK ? n - base : CHUNK;
+    const double *in = msd + base;
+    size_t i = 0;
+    for(; i + SIMD_WIDTH <= len; i += SIMD_WIDTH)
+      vstore(tai+i, vfmadd(vsub(vload(in+i), vmsd0), vsol, vtai0));
+    for(; i < len; i++)
+      tai[i] = sfmadd(in[i] - (44796.0 - 0.0009626), SOL_SECS, TAI_MSD0);
+
+    i = 0;
+    while(i < len){
+      int off = leapCursorOffsetTAI(&cursor, floor(tai[i] + bias));
+      double start = cursor.start - bias;
+      double next = cursor.next - bias;
+      size_t end = i + 1;
+      while(end < len && tai[end] >= start && tai[end] < next)
+        end++;
+      if(cursor.range == LEAP_EXPIRED)
+        leapCountExpired(end - i);
+      TAIrunToUTC(tai+i, utc_sec+base+i, usec == NULL ? NULL : usec+base+i,
+          end-i, off);
+      i = end;
+    }
+  }
+}
+
+/*
+ * Converts n sol dates back to UTC seconds since the Unix epoch and
+ * microseconds, the same as MSDtoUTC_batch on soldateToMSD of each
+ */
+void soldateToUTC_batch(const soldate *dates, int64_t *utc_sec, int32_t *usec,
+    size_t n, leapTable *table){
+  double msd[CHUNK];
+  size_t base;
+  for(base = 0; base < n; base += CHUNK){
+    size_t len = n - base < CHUNK ? n - base : CHUNK;
+    size_t i;
+    for(i=0; i<len; i++)
+      msd[i] = soldateToMSD(&dates[base+i]);
+    MSDtoUTC_batch(msd, utc_sec+base, usec == NULL ? NULL : usec+base, len,
+        table);
+  }
+}
+
+/*
+ * Arguments of the parallel conversions
+ */
+typedef struct{
+  const int64_t *utc_sec;
+  const int32_t *usec;
+  const double *msd;
+  double *msdOut;
+  int64_t *utcOut;
+  int32_t *usecOut;
+  soldate *soldates;
+  const timeZone *tz;
+  leapTable *table;
+} batchJob;
+
+/*
+ * Converts elements [begin, end) of a UTCtoMSD_parallel job
+ */
+static void UTCtoMSDchunk(size_t begin, size_t end, void *arg){
+  batchJob *job = arg;
+  UTCtoMSD_batch(job->utc_sec + begin,
+      job->usec == NULL ? NULL : job->usec + begin,
+      job->msdOut + begin, end - begin, job->table);
+}
+
+/*
+ * UTCtoMSD_batch split into chunks across the given number of threads (0 for
+ * one per CPU); each chunk keeps its own leap second cursor
+ */
+void UTCtoMSD_parallel(const int64_t *utc_sec, const int32_t *usec,
+    double *msd, size_t n, leapTable *table, int threads){
+  batchJob job = {.utc_sec = utc_sec, .usec = usec, .msdOut = msd,
+    .table = table};
+  parallelFor(threads, n, GRAIN, UTCtoMSDchunk, &job);
+}
+
+/*
+ * Converts elements [begin, end) of a MSDtoUTC_parallel job
+ */
+static void MSDtoUTCchunk(size_t begin, size_t end, void *arg){
+  batchJob *job = arg;
+  MSDtoUTC_batch(job->msd + begin, job->utcOut + begin,
+      job->usecOut == NULL ? NULL : job->usecOut + begin, end - begin,
+      job->table);
+}
+
+/*
+ * MSDtoUTC_batch split into chunks across the given number of threads (0 for
+ * one per CPU); each chunk keeps its own leap second cursor
+ */
+void MSDtoUTC_parallel(const double *msd, int64_t *utc_sec, int32_t *usec,
+    size_t n, leapTable *table, int threads){
+  batchJob job = {.msd = msd, .utcOut = utc_sec, .usecOut = usec,
+    .table = table};
+  parallelFor(threads, n, GRAIN, MSDtoUTCchunk, &job);
+}
+
+/*
+ * Converts elements [begin, end) of a MSDtoSoldate_parallel job
+ */
+static void MSDtoSoldateChunk(size_t begin, size_t end, void *arg){
+  batchJob *job = arg;
+  size_t i;
+  for(i=begin; i<end; i++)
+    MSDtoSoldate_r(job->msd[i], job->tz, &job->soldates[i]);
+}
+
+/*
+ * Converts n Mars Sol Dates to broken down times in the given time zone,
+ * split into chunks across the given number of threads (0 for one per CPU)
+ */
+void MSDtoSoldate_parallel(const double *msd, const timeZone *tz,
+    soldate *out, size_t n, int threads){
+  batchJob job = {.msd = msd, .tz = tz, .soldates = out};
+  parallelFor(threads, n, GRAIN, MSDtoSoldateChunk, &job);
+}
+
+/*
+ * Calculates Local True Solar Time at one instant for n longitudes (degrees
+ * west), the same as LTST(MSD, lon[i])
+ * The equation of time is evaluated once for all of them
+ */
+void LTST_batch(double MSD, const double *lon, double *ltst, size_t n){
+  const double perDeg = -1.0 / 360;
+  double base = MSD + EOT(MSDtoJ2K(MSD))/360;
+  vdouble vbase = vset(base);
+  vdouble vperDeg = vset(perDeg);
+  size_t i = 0;
+  for(; i + SIMD_WIDTH <= n; i += SIMD_WIDTH)
+    vstore(ltst+i, vfmadd(vload(lon+i), vperDeg, vbase));
+  for(; i < n; i++)
+    ltst[i] = sfmadd(lon[i], perDeg, base);
+}
@@ -0,0 +1,80 @@
+/*
+ * Array versions of the UTC -> TAI -> J2000 -> MSD chain and its inverse
+ *
+ * The per element work is reduced to one multiply-add: the whole chain is
+ * linear in the timestamp once TAI-UTC is known, so the leap offset is looked
+ * up once for each run of timestamps falling in the same leap second segment
+ * and folded into a constant for that run.
+ */
+
+#ifndef marsbatch
+#define marsbatch
+
+#include <stddef.h>
+#include <stdint.h>
+#include "leapSecs.h"
+#include "marsTime.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Converts n UTC timestamps (seconds since the Unix epoch plus microseconds)
+ * to floating point Mars Sol Dates
+ * usec may be NULL if all timestamps are whole seconds
+ * Equivalent to J2KtoMSD(TAItoJ2K(UTCtoTAI(...))) for each element
+ */
+void UTCtoMSD_batch(const int64_t *utc_sec, const int32_t *usec, double *msd,
+    size_t n, leapTable *table);
+
+/*
+ * Converts n Mars Sol Dates back to UTC seconds since the Unix epoch and
+ * microseconds
+ * usec may be NULL if only whole seconds (rounded down) are wanted
+ * Leap seconds are looked up by TAI with a cursor, an inserted leap second
+ * maps onto the first second after it like in TAItoUTC
+ */
+void MSDtoUTC_batch(const double *msd, int64_t *utc_sec, int32_t *usec,
+    size_t n, leapTable *table);
+
+/*
+ * Converts n sol dates back to UTC seconds since the Unix epoch and
+ * microseconds, the same as MSDtoUTC_batch on soldateToMSD of each
+ */
+void soldateToUTC_batch(const soldate *dates, int64_t *utc_sec, int32_t *usec,
+    size_t n, leapTable *table);
+
+/*
+ * UTCtoMSD_batch split into chunks across the given number of threads (0 for
+ * one per CPU); each chunk keeps its own leap second cursor
+ */
+void UTCtoMSD_parallel(const int64_t *utc_sec, const int32_t *usec,
+    double *msd, size_t n, leapTable *table, int threads);
+
+/*
+ * MSDtoUTC_batch split into chunks across the given number of threads (0 for
+ * one per CPU); each chunk keeps its own leap second cursor
+ */
+void MSDtoUTC_parallel(const double *msd, int64_t *utc_sec, int32_t *usec,
+    size_t n, leapTable *table, int threads);
+
+/*
+ * Converts n Mars Sol Dates to broken down times in the given time zone,
+ * split into chunks across the given number of threads (0 for one per CPU)
+ */
+void MSDtoSoldate_parallel(const double *msd, const timeZone *tz,
+    soldate *out, size_t n, int threads);
+
+/*
+ * Calculates Local True Solar Time at one instant for n longitudes (degrees
+ * west), the same as LTST(MSD, lon[i])
+ * The equation of time is evaluated once for all of them
+ */
+void LTST_batch(double MSD, const double *lon, double *ltst, size_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,76 @@
+/*
+ * static inline versions of the short conversions used on hot paths
+ *
+ * Callers linking the library get these inlined into their own code without
+ * link time optimization. marsTime.c implements the functions of the same
+ * name without the _inline suffix with them, so both give identical results.
+ */
+
+#ifndef marsinline
+#define marsinline
+
+#include <math.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Converts International Atomic Time to Terrestrial Time, see TAItoTT
+ */
+static inline double TAItoTT_inline(double TAI){
+  return TAI + 32.184;
+}
+
+/*
+ * Converts time in seconds since the Unix epoch (TAI) to days since the
+ * J2000 epoch (TT), see TAItoJ2K
+ */
+static inline double TAItoJ2K_inline(double TAI){
+  return (TAI + 32.184) / 86400 - 10957.5;
+}
+
+/*
+ * Converts days since the J2000 epoch (TT) to Mars Sol Date, see J2KtoMSD
+ */
+static inline double J2KtoMSD_inline(double J2K){
+  return (J2K-4.5) / 1.0274912517 + 44796.0 - 0.0009626;
+}
+
+/*
+ * Converts Mars Sol Date to days since the J2000 epoch, see MSDtoJ2K
+ */
+static inline double MSDtoJ2K_inline(double MSD){
+  return 1.0274912517 * (MSD - 44796.0 + 0.0009626) + 4.5;
+}
+
+/*
+ * Calculates Local Mean Solar Time at lon degrees west, see LMST
+ */
+static inline double LMST_inline(double MSD, double lon){
+  return MSD - lon/360;
+}
+
+// a little over the rounding error of an MSD and of a UTC microsecond, in
+// sols, so that an instant computed to be on a second boundary (such as the
+// inverse of a date) is not split into the second before it
+#define SPLIT_EPS (1e-3 / 86400)
+
+/*
+ * Splits frac + offset sols, frac in [0, 1), into whole sols (returned) and
+ * whole Martian seconds into the sol (0 to 86399), see splitSol
+ */
+static inline long splitSol_inline(double frac, double offset, int *secs){
+  double t = frac + offset + SPLIT_EPS;
+  double carry = floor(t);
+  t -= carry;
+  int s = t * 86400;
+  *secs = s > 86399 ? 86399 : s;
+  return carry;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
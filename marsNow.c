@@ -0,0 +1,84 @@
+/*
+ * Current time as TAI and Mars Sol Date
+ */
+
+#include <stdatomic.h>
+#include <time.h>
+#include "marsNow.h"
+
+static atomic_int source = NOW_UNKNOWN;
+
+/*
+ * Returns the kernel's TAI-UTC in seconds, 0 if it is not set
+ */
+int kernelTAIOffset(){
+  struct timespec utc, tai, utc2;
+  // read TAI between two readings of UTC so that a tick between them can't
+  // skew the difference by a whole second
+  clock_gettime(CLOCK_REALTIME, &utc);
+  if(clock_gettime(CLOCK_TAI, &tai) != 0)
+    return 0;
+  clock_gettime(CLOCK_REALTIME, &utc2);
+  int64_t mid = (utc.tv_sec * 1000000000LL + utc.tv_nsec +
+      utc2.tv_sec * 1000000000LL + utc2.tv_nsec) / 2;
+  int64_t diff = tai.tv_sec * 1000000000LL + tai.tv_nsec - mid;
+  return (diff + 500000000) / 1000000000;
+}
+
+/*
+ * Compares the kernel's TAI offset with the leap table and picks the source
+ * for the marsNow functions; they call this on first use
+ * CLOCK_TAI is used if the offset is set and either matches the table or,
+ * once the table has expired, is at least its last offset (the kernel may
+ * know of newer leap seconds)
+ * Returns the enum marsNowSource picked; only the first call checks
+ */
+int marsNowInit(leapTable *table){
+  int s = atomic_load_explicit(&source, memory_order_relaxed);
+  if(s != NOW_UNKNOWN)
+    return s;
+  time_t now = time(NULL);
+  int kernel = kernelTAIOffset();
+  int known = offset(now, table);
+  s = NOW_LEAP_TABLE;
+  if(kernel > 0){
+    if(leapRange(now, table) == LEAP_EXPIRED ? kernel >= known :
+        kernel == known)
+      s = NOW_CLOCK_TAI;
+  }
+  // threads racing here all come to the same answer
+  atomic_store_explicit(&source, s, memory_order_relaxed);
+  return s;
+}
+
+/*
+ * Returns the current TAI in nanoseconds since the Unix epoch
+ */
+int64_t marsNowTAIns(leapTable *table){
+  int s = atomic_load_explicit(&source, memory_order_relaxed);
+  if(__builtin_expect(s == NOW_UNKNOWN, 0))
+    s = marsNowInit(table);
+  struct timespec ts;
+  if(s == NOW_CLOCK_TAI){
+    clock_gettime(CLOCK_TAI, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+  }
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return (ts.tv_sec + offset(ts.tv_sec, table)) * 1000000000LL + ts.tv_nsec;
+}
+
+/*
+ * Returns the current Mars Sol Date
+ */
+double marsNow(leapTable *table){
+  int64_t ns = marsNowTAIns(table);
+  int64_t sec = ns / 1000000000;
+  return TAItoMSD(sec + (ns - sec * 1000000000) / 1e9);
+}
+
+/*
+ * Returns the current Mars Sol Date, exactly, see fixedTime.h
+ */
+marsFixed marsNowFixed(leapTable *table){
+  return TAInsToFixed(marsNowTAIns(table));
+}
@@ -0,0 +1,64 @@
+/*
+ * Current time as TAI and Mars Sol Date
+ *
+ * On Linux, CLOCK_TAI is CLOCK_REALTIME plus the kernel's TAI offset, which
+ * NTP or PTP daemons keep up to date, and it is read through the vDSO without
+ * a system call. It is used when the offset is set and agrees with the leap
+ * table; otherwise UTC from CLOCK_REALTIME goes through the leap table.
+ */
+
+#ifndef marsnow
+#define marsnow
+
+#include <stdint.h>
+#include "leapSecs.h"
+#include "fixedTime.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Where marsNow gets TAI from
+ */
+enum marsNowSource{
+  NOW_UNKNOWN = 0, // not checked yet
+  NOW_CLOCK_TAI = 1, // CLOCK_TAI, the kernel offset is set and trusted
+  NOW_LEAP_TABLE = 2 // CLOCK_REALTIME and the leap table
+};
+
+/*
+ * Compares the kernel's TAI offset with the leap table and picks the source
+ * for the marsNow functions; they call this on first use
+ * CLOCK_TAI is used if the offset is set and either matches the table or,
+ * once the table has expired, is at least its last offset (the kernel may
+ * know of newer leap seconds)
+ * Returns the enum marsNowSource picked; only the first call checks
+ */
+int marsNowInit(leapTable *table);
+
+/*
+ * Returns the kernel's TAI-UTC in seconds, 0 if it is not set
+ */
+int kernelTAIOffset();
+
+/*
+ * Returns the current TAI in nanoseconds since the Unix epoch
+ */
+int64_t marsNowTAIns(leapTable *table);
+
+/*
+ * Returns the current Mars Sol Date
+ */
+double marsNow(leapTable *table);
+
+/*
+ * Returns the current Mars Sol Date, exactly, see fixedTime.h
+ */
+marsFixed marsNowFixed(leapTable *table);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,115 @@
+/*
+ * Thin wrappers around the vector instructions used by the batch conversions
+ *
+ * Picks AVX2 when the compiler targets it, SSE2 otherwise (always present on
+ * x86-64), and plain doubles everywhere else, so the kernels are written once
+ * against vdouble and SIMD_WIDTH.
+ */
+
+#ifndef marssimd
+#define marssimd
+
+#include <stdint.h>
+#include <math.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SIMD_WIDTH 4
+typedef __m256d vdouble;
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SIMD_WIDTH 2
+typedef __m128d vdouble;
+#else
+#define SIMD_WIDTH 1
+typedef double vdouble;
+#endif
+
+/*
+ * Bit pattern of 1.5 * 2^52; adding an integer with magnitude below 2^51 to it
+ * and subtracting the same value as a double converts int64 to double without
+ * AVX-512
+ */
+#define SIMD_I64_MAGIC 0x4338000000000000LL
+#define SIMD_I64_MAGICD 6755399441055744.0
+
+/*
+ * Scalar multiply-add rounded the same way as vfmadd
+ */
+static inline double sfmadd(double a, double b, double c){
+#if defined(__FMA__)
+  return fma(a, b, c);
+#else
+  return a*b + c;
+#endif
+}
+
+#if defined(__AVX2__)
+
+static inline vdouble vset(double x){ return _mm256_set1_pd(x); }
+static inline vdouble vload(const double *p){ return _mm256_loadu_pd(p); }
+static inline void vstore(double *p, vdouble v){ _mm256_storeu_pd(p, v); }
+static inline vdouble vadd(vdouble a, vdouble b){ return _mm256_add_pd(a, b); }
+static inline vdouble vsub(vdouble a, vdouble b){ return _mm256_sub_pd(a, b); }
+static inline vdouble vmul(vdouble a, vdouble b){ return _mm256_mul_pd(a, b); }
+
+static inline vdouble vfmadd(vdouble a, vdouble b, vdouble c){
+#if defined(__FMA__)
+  return _mm256_fmadd_pd(a, b, c);
+#else
+  return _mm256_add_pd(_mm256_mul_pd(a, b), c);
+#endif
+}
+
+static inline vdouble vloadi64(const int64_t *p){
+  __m256i v = _mm256_add_epi64(_mm256_loadu_si256((const __m256i *)p),
+      _mm256_set1_epi64x(SIMD_I64_MAGIC));
+  return _mm256_sub_pd(_mm256_castsi256_pd(v), _mm256_set1_pd(SIMD_I64_MAGICD));
+}
+
+static inline vdouble vloadi32(const int32_t *p){
+  return _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i *)p));
+}
+
+#elif defined(__SSE2__)
+
+static inline vdouble vset(double x){ return _mm_set1_pd(x); }
+static inline vdouble vload(const double *p){ return _mm_loadu_pd(p); }
+static inline void vstore(double *p, vdouble v){ _mm_storeu_pd(p, v); }
+static inline vdouble vadd(vdouble a, vdouble b){ return _mm_add_pd(a, b); }
+static inline vdouble vsub(vdouble a, vdouble b){ return _mm_sub_pd(a, b); }
+static inline vdouble vmul(vdouble a, vdouble b){ return _mm_mul_pd(a, b); }
+
+static inline vdouble vfmadd(vdouble a, vdouble b, vdouble c){
+#if defined(__FMA__)
+  return _mm_fmadd_pd(a, b, c);
+#else
+  return _mm_add_pd(_mm_mul_pd(a, b), c);
+#endif
+}
+
+static inline vdouble vloadi64(const int64_t *p){
+  __m128i v = _mm_add_epi64(_mm_loadu_si128((const __m128i *)p),
+      _mm_set1_epi64x(SIMD_I64_MAGIC));
+  return _mm_sub_pd(_mm_castsi128_pd(v), _mm_set1_pd(SIMD_I64_MAGICD));
+}
+
+static inline vdouble vloadi32(const int32_t *p){
+  return _mm_cvtepi32_pd(_mm_loadl_epi64((const __m128i *)p));
+}
+
+#else
+
+static inline vdouble vset(double x){ return x; }
+static inline vdouble vload(const double *p){ return *p; }
+static inline void vstore(double *p, vdouble v){ *p = v; }
+static inline vdouble vadd(vdouble a, vdouble b){ return a + b; }
+static inline vdouble vsub(vdouble a, vdouble b){ return a - b; }
+static inline vdouble vmul(vdouble a, vdouble b){ return a * b; }
+static inline vdouble vfmadd(vdouble a, vdouble b, vdouble c){ return sfmadd(a, b, c); }
+static inline vdouble vloadi64(const int64_t *p){ return (double)*p; }
+static inline vdouble vloadi32(const int32_t *p){ return (double)*p; }
+
+#endif
+
+#endif
@@ -9,79 +9,66 @@
  * 2012-07-10
  */
 
+#include <string.h>
 #include "marsTime.h"
-
-// Initialize definitions
-void initDefs(){
-  // Definitions of time zones used to show local time and sol count for rovers/landers
-
-  // MTC
-  // Coordinated Mars Time (also AMT, AAT)
-  timeZone MTCtemp = {
-    .startsol = 0,
-    .offset = 0.0,
-    .epochName = "MSD",
-    .zoneName = "MTC",
-    .digits = 5
-  };
-
-  MTC = MTCtemp;
-
-  // Pathfinder
-  timeZone pathfindertemp = {
-    .startsol = 43904, // Sol 1 = 1997-07-04 16:56:55
-    .offset = -7981., // AAT-02:13:01
-    .epochName = "MP", // Mars Pathfinder (unofficial)
-    .zoneName = "",
-    .digits = 4
-  };
-
-  pathfinder = pathfindertemp;
-
-  // Spirit
-  timeZone spirittemp = {
-    .startsol = 46215, // Sol 1 = 2004-01-04 04:35
-    .offset = 39840., // AAT+11:00:04
-    .epochName = "MER-A", // Mars Exploration Rover A
-    .zoneName = "",
-    .digits = 4
-  };
-
-  spirit = spirittemp;
-
-  // Opportunity
-  const timeZone opportunitytemp = {
-    .startsol = 46235, // Sol 1 = 2004-01-25 05:05
-    .offset = -3666., // AAT-01:01:06
-    .epochName = "MER-B", // Mars Exploration Rover B
-    .zoneName = "",
-    .digits = 4
-  };
-
-  opportunity = opportunitytemp;
-
-  // Phoenix
-  const timeZone phoenixtemp = {
-    .startsol = 47776, // Sol 0 = 2008-05-25 23:53:52
-    .offset = -30396., // AAT-08:26:36, LMST at 233.35 E
-    .epochName = "MPh", // Mars Phoenix (unofficial)
-    .zoneName = "",
-    .digits = 4
-  };
-
-  phoenix = phoenixtemp;
-
-  // Curiosity
-  const timeZone curiositytemp = {
-    .startsol = 49269, // Sol 0 = 2012-08-05 05:51
-    .offset = 32981.736, // AAT+09:09:41.736, LMST at 137.4239 E
-    .epochName = "MSL", // Mars Science Laboratory
-    .zoneName = "",
-    .digits = 4
-  };
-
-  curiosity = curiositytemp;
-}
+#include "marsInline.h"
+
+// Definitions of time zones used to show local time and sol count for rovers/landers
+
+// MTC
+// Coordinated Mars Time (also AMT, AAT)
+const timeZone MTC = {
+  .startsol = 0,
+  .offset = 0.0,
+  .epochName = "MSD",
+  .zoneName = "MTC",
+  .digits = 5
+};
+
+// Pathfinder
+const timeZone pathfinder = {
+  .startsol = 43904, // Sol 1 = 1997-07-04 16:56:55
+  .offset = -7981., // AAT-02:13:01
+  .epochName = "MP", // Mars Pathfinder (unofficial)
+  .zoneName = "",
+  .digits = 4
+};
+
+// Spirit
+const timeZone spirit = {
+  .startsol = 46215, // Sol 1 = 2004-01-04 04:35
+  .offset = 39840., // AAT+11:00:04
+  .epochName = "MER-A", // Mars Exploration Rover A
+  .zoneName = "",
+  .digits = 4
+};
+
+// Opportunity
+const timeZone opportunity = {
+  .startsol = 46235, // Sol 1 = 2004-01-25 05:05
+  .offset = -3666., // AAT-01:01:06
+  .epochName = "MER-B", // Mars Exploration Rover B
+  .zoneName = "",
+  .digits = 4
+};
+
+// Phoenix
+const timeZone phoenix = {
+  .startsol = 47776, // Sol 0 = 2008-05-25 23:53:52
+  .offset = -30396., // AAT-08:26:36, LMST at 233.35 E
+  .epochName = "MPh", // Mars Phoenix (unofficial)
+  .zoneName = "",
+  .digits = 4
+};
+
+// Curiosity
+const timeZone curiosity = {
+  .startsol = 49269, // Sol 0 = 2012-08-05 05:51
+  .offset = 32981.736, // AAT+09:09:41.736, LMST at 137.4239 E
+  .epochName = "MSL", // Mars Science Laboratory
+  .zoneName = "",
+  .digits = 4
+};
 
 ////////////////////////////////////////////////////////////////////////////////
 // Conversions between Terran times
@@ -91,7 +78,7 @@ void initDefs(){
  * Converts International Atomic Time to Terrestrial Time
  */
 double TAItoTT(double TAI){
-  return TAI + 32.184;
+  return TAItoTT_inline(TAI);
 }
 
 /*
@@ -137,7 +124,7 @@ double J2KtoTT(double J2K){
  * J2000 epoch (TT)
  */
 double TAItoJ2K(double TAI){
-  return (TAI + 32.184) / 86400 - 10957.5;
+  return TAItoJ2K_inline(TAI);
 }
 
 /*
@@ -156,6 +143,24 @@ double UTCstructToTAIfloat(struct timeval *structTime, leapTable *table){
   return StructToFloat(structTime);
 } 
 
+/*
+ * Converts double precision floating point TAI to a UTC timeval struct, the
+ * inverse of UTCstructToTAIfloat
+ * Returns out
+ */
+struct timeval* TAIfloatToUTCstruct(double TAI, leapTable *table,
+    struct timeval *out){
+  double sec = floor(TAI);
+  long usec = llround((TAI - sec) * 1e6);
+  if(usec == 1000000){
+    sec += 1;
+    usec = 0;
+  }
+  out->tv_sec = TAItoUTC(sec, table);
+  out->tv_usec = usec;
+  return out;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Conversions from Terran to Martian Times
 ////////////////////////////////////////////////////////////////////////////////
@@ -166,11 +171,11 @@ double UTCstructToTAIfloat(struct timeval *structTime, leapTable *table){
  * Equation C-2 (modified)
  */
 double J2KtoMSD(double J2K){
-  return (J2K-4.5) / 1.027491252 + 44796.0 - 0.00096;
+  return J2KtoMSD_inline(J2K);
 }
 
 /*
- * Converts seconds since the Unix epoch (TAI) to days since J2000 epoch (TT)
+ * Converts seconds since the Unix epoch (TAI) to Mars Sol Date
  */
 double TAItoMSD(double TAI){
   return J2KtoMSD(TAItoJ2K(TAI));
@@ -185,8 +190,7 @@ double TAItoMSD(double TAI){
  * Equation C-1
  */
 double EOT(double J2K){
-  int Lsval = Ls(J2K)*DEG;
-  return 2.861*sin(2*Lsval) - 0.071*sin(4*Lsval) + 0.002*sin(6*Lsval)-(EOC(J2K));
+  return EOT_precision(J2K, MARS_PRECISION_FULL);
 }
 
 /*
@@ -197,92 +201,156 @@ double EOT(double J2K){
  * Equation C-4
  */
 double LMST(double MSD, double lon){
-  return MSD - lon/360;
+  return LMST_inline(MSD, lon);
 }
 
 /*
  * Calculates Local True Solar Time
  * Uses the equation of time to calculate the true solar time based on the
  * position of the sun in the sky at the given time and longitude
- * Equation C-4
+ * Like LMST the result counts sols, the fractional part is the time of day
+ * Equation C-5
  */
 double LTST(double MSD, double lon){
-  return 0;
+  return LMST(MSD, lon) + EOT(MSDtoJ2K(MSD))/360;
 }
 
 /*
- * Determine subsolar longitude
+ * Eq. C-5 from MSD and the equation of time (degrees) at it
+ */
+static inline double subsolAt(double MSD, double eot){
+  double lon = fmod(360*(MSD - floor(MSD)) + eot + 180, 360);
+  return lon < 0 ? lon + 360 : lon;
+}
+
+/*
+ * Determine subsolar longitude (degrees west, 0 to 360)
  * Eq. C-5
  */
-//double subsolLon(double 
+double subsolLon(double MSD){
+  return subsolAt(MSD, EOT(MSDtoJ2K(MSD)));
+}
 
 /*
  * Converts floating point MSD to broken down time with sol, hour, minute,
  * second
+ * The result is malloc'd and must be freed by the caller
  */
-soldate* MSDtoSoldate(double MSD, timeZone *tz){
-  /*printf("%f\n", MSD);*/
-  MSD -= tz->startsol;
-  /*printf("%f\n", MSD);*/
-  MSD += tz->offset/86400;
-  /*printf("offset=%f\n", tz->offset);*/
-  /*printf("%f\n", MSD);*/
-  long sol;
-  int hour, min, sec;
-  sol = MSD;
-  MSD -= sol;
-  if(MSD<0){
-    MSD += 1;
-    sol -= 1;
-  }
-  MSD *= 24;
-  hour = MSD;
-  MSD -= hour;
-  MSD *= 60;
-  min = MSD;
-  MSD -= min;
-  MSD *= 60;
-  sec = MSD;
+soldate* MSDtoSoldate(double MSD, const timeZone *tz){
   soldate *date = malloc(sizeof(soldate));
   if(date == NULL){
     printf("Cannot allocate memory for soldate\n");
     exit(1);
   }
-  date->sol = sol;
-  date->hour = hour;
-  date->min = min;
-  date->sec = sec;
-  date->tz = tz;
-  return date;
+  return MSDtoSoldate_r(MSD, tz, date);
+}
+
+/*
+ * Splits frac + offset sols, frac in [0, 1), into whole sols (returned) and
+ * whole Martian seconds into the sol (0 to 86399); instants within a
+ * millisecond before a second count as that second
+ * MSDtoSoldate_r, convertAllZones and the Darian calendar all split this way
+ * with frac the fraction of MSD and offset that of the zone, so they agree to
+ * the second
+ */
+long splitSol(double frac, double offset, int *secs){
+  return splitSol_inline(frac, offset, secs);
 }
 
 /*
- * Converts floating point MSD to broken down time representing a date on the
- * Darian Calendar
+ * Converts floating point MSD to broken down time with sol, hour, minute,
+ * second, stored in out
+ * Returns out
  */
-marsCalDate MSDtoDarian(double MSD);
+soldate* MSDtoSoldate_r(double MSD, const timeZone *tz, soldate *out){
+  double whole = floor(MSD);
+  int secs;
+  long carry = splitSol_inline(MSD - whole, tz->offset/86400, &secs);
+  out->sol = (long)whole + carry - tz->startsol;
+  out->hour = secs / 3600;
+  out->min = secs / 60 % 60;
+  out->sec = secs % 60;
+  out->tz = tz;
+  return out;
+}
+
+/*
+ * Writes val with at least digits digits, zero padded, and returns the
+ * position after it
+ */
+static char* putDigits(char *p, unsigned long val, int digits){
+  char tmp[24];
+  int n = 0;
+  do{
+    tmp[n++] = '0' + val % 10;
+    val /= 10;
+  }while(val != 0);
+  while(n < digits)
+    tmp[n++] = '0';
+  while(n > 0)
+    *p++ = tmp[--n];
+  return p;
+}
 
 /*
  * Returns a pointer to a string representing the date in the format
  * SSSSS HH:MM:SS
  * e.g. MSD 44796 12:34:56 MTC
  *      MSL 0034 14:54:49
+ * The string is malloc'd and must be freed by the caller
  */
 char* soldateToString(soldate *soldate){
-  /*printf("sol=%d\n", soldate->sol);*/
-  int soldigits = soldate->tz->digits;
-  /*printf("%08X\n", soldate->tz);*/
-  /*printf("soldigits=%d\n", soldigits);*/
-  int length = 18 + soldigits;
+  size_t length = strlen(soldate->tz->epochName) + strlen(soldate->tz->zoneName)
+    + soldate->tz->digits + 32;
   char *str = malloc(length * sizeof(char));
-  char *format = malloc(6 * sizeof(char));
-  snprintf(format, 27, "%%s %%0%dld %%02d:%%02d:%%02d %%s", soldigits);
-  snprintf(str, length, format, soldate->tz->epochName, soldate->sol, soldate->hour,
-      soldate->min, soldate->sec, soldate->tz->zoneName);
-  free(format);
+  if(str == NULL){
+    printf("Cannot allocate memory for soldate string\n");
+    exit(1);
+  }
+  soldateFormat(str, length, soldate);
   return str;
 }
 
+/*
+ * Writes the string soldateToString would return into buf, which has room
+ * for cap characters including the terminating null
+ * Returns the length of the string, or -1 (and writes nothing) if it doesn't
+ * fit
+ */
+int soldateFormat(char *buf, size_t cap, const soldate *date){
+  // " SOL HH:MM:SS", at most 1 + 20 + 1 + 8 characters
+  char num[32];
+  char *p = num;
+  *p++ = ' ';
+  if(date->sol < 0){
+    *p++ = '-';
+    p = putDigits(p, -(unsigned long)date->sol, date->tz->digits - 1);
+  }
+  else
+    p = putDigits(p, date->sol, date->tz->digits);
+  *p++ = ' ';
+  p = putDigits(p, date->hour, 2);
+  *p++ = ':';
+  p = putDigits(p, date->min, 2);
+  *p++ = ':';
+  p = putDigits(p, date->sec, 2);
+
+  size_t epochLen = strlen(date->tz->epochName);
+  size_t zoneLen = strlen(date->tz->zoneName);
+  size_t numLen = p - num;
+  size_t len = epochLen + numLen + (zoneLen > 0 ? zoneLen + 1 : 0);
+  if(len >= cap)
+    return -1;
+  memcpy(buf, date->tz->epochName, epochLen);
+  memcpy(buf + epochLen, num, numLen);
+  if(zoneLen > 0){
+    buf[epochLen + numLen] = ' ';
+    memcpy(buf + epochLen + numLen + 1, date->tz->zoneName, zoneLen);
+  }
+  buf[len] = '\0';
+  return len;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Martian Orbital Parameters
 ////////////////////////////////////////////////////////////////////////////////
@@ -292,7 +360,7 @@ char* soldateToString(soldate *soldate){
  * Equation B-1
  */
 double meanAnom(double J2K){
-  return 19.3780 + 0.52402075 * J2K;
+  return 19.3871 + 0.52402073 * J2K;
 }
 
 /*
@@ -300,42 +368,271 @@ double meanAnom(double J2K){
  * Equation B-2
  */
 double FMS(double J2K){
-  return 270.3863 + 0.52403840 * J2K;
+  return 270.3871 + 0.524038496 * J2K;
 }
 
+// amplitudes (deg), periods (Julian years) and phases (deg) of Equation B-3
+static const double pertA[] = {0.0071, 0.0057, 0.0039, 0.0037, 0.0021,
+  0.0020, 0.0018};
+static const double pertTau[] = {2.2353, 2.7543, 1.1177, 15.7866, 2.1354,
+  2.4694, 32.8493};
+static const double pertPhi[] = {49.409, 168.173, 191.837, 21.736, 15.704,
+  95.528, 49.095};
+
 /*
  * Determine Perturbers
  * Equation B-3
  */
 double PBS(double J2K){
-  int pertA[] = {0.0071, 0.0057, 0.0039, 0.0037, 0.0021, 0.0020, 0.0018};
-  int pertTau[] = {2.2353, 2.7543, 1.1177, 15.7866, 2.1354, 2.4694, 32.8493};
-  int pertPhi[] = {49.409, 168.173, 191.837, 21.736, 15.704, 95.528, 49.095};
   double sum = 0.0;
   int i;
   double degperday = 360*DEG/365.25;
   for(i=0; i<7; i++){
-    sum += pertA[i] * cos(degperday * J2K / pertTau[i]) + pertPhi[i];
+    sum += pertA[i] * cos(degperday * J2K / pertTau[i] + pertPhi[i]*DEG);
   }
   return sum;
 }
 
+/*
+ * Determine areocentric solar longitude
+ * Equation B-5
+ */
+double Ls(double J2K){
+  return Ls_precision(J2K, MARS_PRECISION_FULL);
+}
+
+/*
+ * Sine and cosine of x (radians) from Taylor polynomials on a quarter turn,
+ * within 2e-10 of sin and cos for |x| up to a few thousand
+ */
+static inline void sinCos(double x, double *s, double *c){
+  long q = x * (2/PI) + (x < 0 ? -0.5 : 0.5);
+  double r = x - q * (PI/2);
+  double r2 = r * r;
+  double sn = r * (1 + r2 * (-1/6.0 + r2 * (1/120.0 + r2 * (-1/5040.0 +
+      r2 * (1/362880.0 - r2/39916800.0)))));
+  double cs = 1 + r2 * (-1/2.0 + r2 * (1/24.0 + r2 * (-1/720.0 +
+      r2 * (1/40320.0 + r2 * (-1/3628800.0 + r2/479001600.0)))));
+  // rotate by q quarter turns without branches, quadrants are random
+  double a = q & 1 ? cs : sn;
+  double b = q & 1 ? sn : cs;
+  *s = q & 2 ? -a : a;
+  *c = (q + 1) & 2 ? -b : b;
+}
+
+/*
+ * Sine and cosine of x (radians) like sinCos with shorter polynomials,
+ * within 4e-5 of sin and cos
+ */
+static inline void sinCosShort(double x, double *s, double *c){
+  long q = x * (2/PI) + (x < 0 ? -0.5 : 0.5);
+  double r = x - q * (PI/2);
+  double r2 = r * r;
+  double sn = r * (1 + r2 * (-1/6.0 + r2/120.0));
+  double cs = 1 + r2 * (-1/2.0 + r2 * (1/24.0 - r2/720.0));
+  double a = q & 1 ? cs : sn;
+  double b = q & 1 ? sn : cs;
+  *s = q & 2 ? -a : a;
+  *c = (q + 1) & 2 ? -b : b;
+}
+
+/*
+ * Evaluates Equations B-1 to B-5 into s at precision p, and the sines and
+ * cosines of M to 5M and 4M into sinM and cosM
+ * sin(nM) and cos(nM) are built up from sin(M) and cos(M) with the
+ * Chebyshev recurrences sin((n+1)x) = 2cos(x)sin(nx) - sin((n-1)x) and
+ * cos((n+1)x) = 2cos(x)cos(nx) - cos((n-1)x), and likewise for the multiples
+ * of 2Ls in the equation of time, so each series costs one sin/cos pair
+ * Always inlined so that each caller only carries the code of its precision
+ */
+static inline __attribute__((always_inline)) void orbitLs(double J2K,
+    marsPrecision p, marsOrbitState *s, double *sinM, double *cosM){
+  s->J2K = J2K;
+  s->M = meanAnom(J2K);
+  s->alphaFMS = FMS(J2K);
+  s->PBS = p == MARS_PRECISION_FULL ? PBS(J2K) : 0;
+
+  double M = s->M * DEG;
+  sinM[0] = 0;
+  cosM[0] = 1;
+  if(p == MARS_PRECISION_FULL){
+    sinM[1] = sin(M);
+    cosM[1] = cos(M);
+  }else if(p == MARS_PRECISION_FAST)
+    sinCos(M, &sinM[1], &cosM[1]);
+  else
+    sinCosShort(M, &sinM[1], &cosM[1]);
+  double twoCos = 2 * cosM[1];
+  int n;
+  for(n=2; n<=5; n++)
+    sinM[n] = twoCos * sinM[n-1] - sinM[n-2];
+  for(n=2; n<=4; n++)
+    cosM[n] = twoCos * cosM[n-1] - cosM[n-2];
+
+  if(p == MARS_PRECISION_APPROX)
+    s->EOC = 10.691 * sinM[1] + 0.623 * sinM[2] + 0.050 * sinM[3];
+  else
+    s->EOC = (10.691 + 3e-7 * J2K) * sinM[1] + 0.623 * sinM[2] +
+      0.050 * sinM[3] + 0.005 * sinM[4] + 0.0005 * sinM[5] + s->PBS;
+  s->Ls = s->alphaFMS + s->EOC;
+}
+
+/*
+ * Evaluates Equation C-1 into s at precision p from what orbitLs left in s,
+ * sinM and cosM
+ */
+static inline __attribute__((always_inline)) void orbitEOT(marsPrecision p,
+    marsOrbitState *s, const double *sinM, const double *cosM){
+  double sin2, cos2;
+  if(p == MARS_PRECISION_FULL){
+    sin2 = sin(2*s->Ls*DEG);
+    cos2 = cos(2*s->Ls*DEG);
+  }else if(p == MARS_PRECISION_FAST)
+    sinCos(2*s->Ls*DEG, &sin2, &cos2);
+  else{
+    // 2Ls is 2M turned by 2(alphaFMS - M) = 502.0000 + 3.5532e-5 J2K degrees
+    // and by 2EOC; the constant part of the turn is tabulated and the rest
+    // stays under 0.5 radians, where short polynomials do
+    double sin2M = sinM[2], cos2M = cosM[2];
+    double sinK = 0.6156614753256584, cosK = -0.7880107536067219;
+    double sinA = sin2M * cosK + cos2M * sinK;
+    double cosA = cos2M * cosK - sin2M * sinK;
+    double d = (3.5532e-5 * s->J2K + 2 * s->EOC) * DEG;
+    double d2 = d * d;
+    double sinD = d * (1 + d2 * (-1/6.0 + d2 * (1/120.0 - d2/5040.0)));
+    double cosD = 1 + d2 * (-1/2.0 + d2 * (1/24.0 - d2/720.0));
+    sin2 = sinA * cosD + cosA * sinD;
+    cos2 = cosA * cosD - sinA * sinD;
+  }
+  double sin4 = 2 * sin2 * cos2;
+  double cos4 = 2 * cos2 * cos2 - 1;
+  double sin6 = sin4 * cos2 + cos4 * sin2;
+  s->EOT = 2.861*sin2 - 0.071*sin4 + 0.002*sin6 - s->EOC;
+}
+
+/*
+ * Ls at a precision known when inlined, see Ls_precision
+ */
+static inline __attribute__((always_inline)) double lsAt(double J2K,
+    marsPrecision p){
+  marsOrbitState s;
+  double sinM[6], cosM[5];
+  orbitLs(J2K, p, &s, sinM, cosM);
+  return s.Ls;
+}
+
+/*
+ * EOT at a precision known when inlined, see EOT_precision
+ */
+static inline __attribute__((always_inline)) double eotAt(double J2K,
+    marsPrecision p){
+  marsOrbitState s;
+  double sinM[6], cosM[5];
+  orbitLs(J2K, p, &s, sinM, cosM);
+  orbitEOT(p, &s, sinM, cosM);
+  return s.EOT;
+}
+
 /*
  * Determine Equation of Center
  * Equation B-4
  */
 double EOC(double J2K){
-  double M = meanAnom(J2K) * DEG;
-  return (10.691 + 3e-7 * J2K) * sin(M) + 0.623 * sin(2*M) + 0.050 * sin(3*M) +
-    0.005 * sin(4*M) + 0.0005 * sin(5*M) + PBS(J2K);
+  marsOrbitState s;
+  double sinM[6], cosM[5];
+  orbitLs(J2K, MARS_PRECISION_FULL, &s, sinM, cosM);
+  return s.EOC;
 }
 
 /*
- * Determine areocentric solar longitude
- * Equation B-5
+ * Areocentric solar longitude (degrees) at the given precision
  */
-double Ls(double J2K){
-  return FMS(J2K) + EOC(J2K);
+double Ls_precision(double J2K, marsPrecision p){
+  switch(p){
+    case MARS_PRECISION_FULL: return lsAt(J2K, MARS_PRECISION_FULL);
+    case MARS_PRECISION_FAST: return lsAt(J2K, MARS_PRECISION_FAST);
+    default: return lsAt(J2K, MARS_PRECISION_APPROX);
+  }
+}
+
+/*
+ * Equation of time (degrees) at the given precision
+ */
+double EOT_precision(double J2K, marsPrecision p){
+  switch(p){
+    case MARS_PRECISION_FULL: return eotAt(J2K, MARS_PRECISION_FULL);
+    case MARS_PRECISION_FAST: return eotAt(J2K, MARS_PRECISION_FAST);
+    default: return eotAt(J2K, MARS_PRECISION_APPROX);
+  }
+}
+
+/*
+ * Local True Solar Time at lon degrees west with the equation of time at the
+ * given precision, see LTST
+ */
+double LTST_precision(double MSD, double lon, marsPrecision p){
+  return LMST(MSD, lon) + EOT_precision(MSDtoJ2K(MSD), p)/360;
+}
+
+/*
+ * Returns the largest error of Ls_precision and EOT_precision at precision p
+ * (degrees), as measured by marsBench --accuracy
+ */
+double marsPrecisionBound(marsPrecision p){
+  switch(p){
+    case MARS_PRECISION_FULL: return 0;
+    case MARS_PRECISION_FAST: return MARS_PRECISION_FAST_BOUND;
+    default: return MARS_PRECISION_APPROX_BOUND;
+  }
+}
+
+/*
+ * Returns the cheapest precision whose error stays within tol degrees
+ */
+marsPrecision marsPrecisionFor(double tol){
+  if(tol >= MARS_PRECISION_APPROX_BOUND)
+    return MARS_PRECISION_APPROX;
+  if(tol >= MARS_PRECISION_FAST_BOUND)
+    return MARS_PRECISION_FAST;
+  return MARS_PRECISION_FULL;
+}
+
+/*
+ * Eq. D-3 from J2K and Ls at it
+ */
+static inline double helioLong(double J2K, double Ls){
+  return Ls + 85.061-0.015*sin((71+2*Ls)*DEG)-5.5e-6*J2K;
+}
+
+/*
+ * Eq. D-4 from J2K and Ls at it
+ */
+static inline double helioLat(double J2K, double Ls){
+  return -(1.8497-2.23e-5*J2K)*sin((Ls-144.50+2.57e-6*J2K)*DEG);
+}
+
+/*
+ * Evaluates Equations B-1 to B-5, C-1, C-5 and D-1 to D-4 at one instant
+ */
+marsOrbitState computeOrbit(double J2K){
+  marsOrbitState s;
+  double sinM[6], cosM[5];
+  orbitLs(J2K, MARS_PRECISION_FULL, &s, sinM, cosM);
+  orbitEOT(MARS_PRECISION_FULL, &s, sinM, cosM);
+
+  // Equation C-5
+  s.subsolLon = subsolAt(J2KtoMSD(J2K), s.EOT);
+
+  // Equations D-1 and D-2
+  double sinLs = sin(s.Ls*DEG);
+  s.solDec = asin(0.42565*sinLs)/DEG + 0.25 * sinLs;
+  s.sunDist = 1.523679 * (1.00436 - 0.09309*cosM[1] - 0.004336*cosM[2]
+      - 0.00031*cosM[3] - 0.00003*cosM[4]);
+
+  // Equations D-3 and D-4
+  s.sunLong = helioLong(J2K, s.Ls);
+  s.sunLat = helioLat(J2K, s.Ls);
+  return s;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -348,7 +645,32 @@ double Ls(double J2K){
  * Equation C-2 (inverse)
  */
 double MSDtoJ2K(double MSD){
-  return 1.027491252 * (MSD - 44796.0 + 0.00096) + 4.5;
+  return MSDtoJ2K_inline(MSD);
+}
+
+/*
+ * Converts Mars Sol Date to seconds since the Unix epoch (TAI)
+ */
+double MSDtoTAI(double MSD){
+  return J2KtoTAI(MSDtoJ2K(MSD));
+}
+
+/*
+ * Converts Mars Sol Date to a UTC timeval struct
+ * Returns out
+ */
+struct timeval* MSDtoUTCstruct(double MSD, leapTable *table,
+    struct timeval *out){
+  return TAIfloatToUTCstruct(MSDtoTAI(MSD), table, out);
+}
+
+/*
+ * Converts a broken down sol date back to Mars Sol Date, the inverse of
+ * MSDtoSoldate_r (to the second)
+ */
+double soldateToMSD(const soldate *date){
+  double secs = (date->hour * 60 + date->min) * 60 + date->sec;
+  return date->sol + date->tz->startsol + (secs - date->tz->offset) / 86400;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -356,12 +678,12 @@ double MSDtoJ2K(double MSD){
 ////////////////////////////////////////////////////////////////////////////////
 
 /*
- * Determine solar declination (planetographic)
+ * Determine solar declination (planetographic, deg)
  * Eq. D-1
  */
 double solDec(double Ls){
   Ls = Ls*DEG;
-  return asin(0.42565*sin(Ls)) + 0.25 * sin(Ls)/DEG;
+  return asin(0.42565*sin(Ls))/DEG + 0.25 * sin(Ls);
 }
 
 /*
@@ -379,8 +701,7 @@ double sunDist(double meanAnom){
  * Eq. D-3
  */
 double sunLong(double J2K){
-  double Lsval = Ls(J2K);
-  return Lsval + 85.061-0.015*sin((71+2*Lsval)*DEG)-5.5e-6*J2K;
+  return helioLong(J2K, Ls(J2K));
 }
 
 /*
@@ -388,17 +709,20 @@ double sunLong(double J2K){
  * Eq. D-4
  */
 double sunLat(double J2K){
-  return -(1.8497-2.23e-5*J2K)*sin((Ls(J2K)-144.50+2.57e-6*J2K)*DEG);
+  return helioLat(J2K, Ls(J2K));
 }
 
 /*
- * Determine local solar elevation
+ * Determine local solar elevation (deg) at planetographic latitude lat and
+ * longitude lon (degrees west)
  * Eq. D-5
  */
-//double sunElev(double J2K, double lat, double lon){
-//  double solDecVal = solDec(Ls(J2K)*DEG)*DEG;
-//}  
-  
+double sunElev(double J2K, double lat, double lon){
+  double elev, az;
+  sunPosition(computeOrbit(J2K), lat, lon, &elev, &az);
+  return elev;
+}
+
 /*
  * Determine local solar azimuth (deg)
  *
@@ -406,6 +730,25 @@ double sunLat(double J2K){
  * is its azimuth, i.e., compass angle relative to due north.
  * Eq. D-6
  */
-double sunAz(double solDec, double lat, double lon){
-  return 0;
+double sunAz(double J2K, double lat, double lon){
+  double elev, az;
+  sunPosition(computeOrbit(J2K), lat, lon, &elev, &az);
+  return az;
+}
+
+/*
+ * Determine local solar elevation and azimuth (deg) for an instant already
+ * evaluated by computeOrbit
+ * Eqs. D-5 and D-6
+ */
+void sunPosition(marsOrbitState orbit, double lat, double lon, double *elev,
+    double *az){
+  double dec = orbit.solDec*DEG;
+  double H = (lon - orbit.subsolLon)*DEG;
+  lat = lat*DEG;
+  double cosH = cos(H);
+  double cosZ = sin(dec)*sin(lat) + cos(dec)*cos(lat)*cosH;
+  *elev = 90 - acos(cosZ)/DEG;
+  double A = atan2(sin(H), cos(lat)*tan(dec) - sin(lat)*cosH)/DEG;
+  *az = A < 0 ? A + 360 : A;
 }
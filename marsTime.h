@@ -17,7 +17,13 @@
 #include <time.h>
 #include <math.h>
 #include <stdint.h>
+#include <sys/time.h>
 #include "leapSecs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 #define PI M_PI
 #define DEG (PI/180)
 
@@ -32,8 +38,8 @@
 typedef struct{
   long startsol; // sol 0, in MSD
   double offset; // martian seconds ahead of MTC
-  char *epochName; // name at beginning of str
-  char *zoneName; // name at end of str
+  const char *epochName; // name at beginning of str
+  const char *zoneName; // name at end of str
   int digits; // min digits to be displayed in sol
 } timeZone;
 
@@ -44,7 +50,7 @@ typedef struct{
 typedef struct{
   long sol;
   int hour, min, sec;
-  timeZone *tz;
+  const timeZone *tz;
 } soldate;
 
 /*
@@ -53,73 +59,39 @@ typedef struct{
 typedef struct{
   long year;
   int month, sol, hour, min, sec;
-  timeZone *tz;
+  const timeZone *tz;
 } marsCalDate;
 
+/*
+ * Orbital parameters of Mars and the position of the sun at one instant,
+ * as calculated by computeOrbit
+ */
+typedef struct{
+  double J2K; // days since the J2000 epoch (TT)
+  double M; // mean anomaly (deg), B-1
+  double alphaFMS; // angle of Fiction Mean Sun (deg), B-2
+  double PBS; // perturbers (deg), B-3
+  double EOC; // equation of center (deg), B-4
+  double Ls; // areocentric solar longitude (deg), B-5
+  double EOT; // equation of time (deg), C-1
+  double subsolLon; // subsolar longitude (deg west), C-5
+  double solDec; // solar declination (deg), D-1
+  double sunDist; // heliocentric distance (au), D-2
+  double sunLong; // heliocentric longitude (deg), D-3
+  double sunLat; // heliocentric latitude (deg), D-4
+} marsOrbitState;
+
 /*int main(int argc, char *argv[]);*/
 
-// Definitions of time zones used to show local time and sol count for rovers/landers
-
-// MTC
-// Coordinated Mars Time (also AMT, AAT)
-timeZone MTC;
-  /*.startsol = 0,*/
-  /*.offset = 0.0,*/
-  /*.epochName = "MSD",*/
-  /*.zoneName = "MTC",*/
-  /*.digits = 5*/
-  /*};*/
-
-// Pathfinder
-/*const timeZone pathfinder = {*/
-/*.startsol = 43904, // Sol 1 = 1997-07-04 16:56:55*/
-/*.offset = -7981., // AAT-02:13:01*/
-/*.epochName = "MP", // Mars Pathfinder (unofficial)*/
-/*.zoneName = "",*/
-/*.digits = 4*/
-/*};*/
-
-/*// Spirit*/
-/*const timeZone spirit = {*/
-/*.startsol = 46215, // Sol 1 = 2004-01-04 04:35*/
-/*.offset = 39840., // AAT+11:00:04*/
-/*.epochName = "MER-A", // Mars Exploration Rover A*/
-/*.zoneName = "",*/
-/*.digits = 4*/
-/*};*/
-
-/*// Opportunity*/
-/*const timeZone opportunity= {*/
-/*.startsol = 46235, // Sol 1 = 2004-01-25 05:05*/
-/*.offset = 3666., // AAT-01:01:06*/
-/*.epochName = "MER-B", // Mars Exploration Rover B*/
-/*.zoneName = "",*/
-/*.digits = 4*/
-/*};*/
-
-/*// Phoenix*/
-/*const timeZone phoenix= {*/
-/*.startsol = 47776, // Sol 0 = 2008-05-25 23:53:52*/
-/*.offset = -30396., // AAT-08:26:36, LMST at 233.35 E*/
-/*.epochName = "MSL", // Mars Science Laboratory*/
-/*.zoneName = "",*/
-/*.digits = 4*/
-/*};*/
-
-/*// Curiosity*/
-/*const timeZone curiosity = {*/
-/*.startsol = 46269, // Sol 0 = 2012-08-05 05:51*/
-/*.offset = 32981.736, // AAT+09:09:41.736, LMST at 137.4239 E*/
-/*.epochName = "MSL", // Mars Science Laboratory*/
-/*.zoneName = "",*/
-/*.digits = 4*/
-/*};*/
-
-timeZone pathfinder;
-timeZone spirit;
-timeZone opportunity;
-timeZone phoenix;
-timeZone curiosity;
+// Definitions of time zones used to show local time and sol count for
+// rovers/landers, see marsTime.c; zones.h looks them up by epoch name
+
+extern const timeZone MTC; // Coordinated Mars Time (also AMT, AAT)
+extern const timeZone pathfinder;
+extern const timeZone spirit;
+extern const timeZone opportunity;
+extern const timeZone phoenix;
+extern const timeZone curiosity;
 
 ////////////////////////////////////////////////////////////////////////////////
 // Conversions between Terran times
@@ -153,17 +125,35 @@ double splitToFloat(time_t tv_sec, suseconds_t tv_usec);
  */
 double TTtoJ2K(double TT);
 
+/*
+ * Inverse of TTtoJ2K
+ */
+double J2KtoTT(double J2K);
+
 /*
  * Converts time in seconds since the Unix epoch (TAI) to days since the
  * J2000 epoch (TT)
  */
 double TAItoJ2K(double TAI);
 
+/*
+ * Inverse of TAItoJ2K
+ */
+double J2KtoTAI(double J2K);
+
 /*
  * Converts UTC timeval struct as returned by gettimeofday to double precision floating point TAI
  */
 double UTCstructToTAIfloat(struct timeval *structTime, leapTable *table);
 
+/*
+ * Converts double precision floating point TAI to a UTC timeval struct, the
+ * inverse of UTCstructToTAIfloat
+ * Returns out
+ */
+struct timeval* TAIfloatToUTCstruct(double TAI, leapTable *table,
+    struct timeval *out);
+
 ////////////////////////////////////////////////////////////////////////////////
 // Conversions from Terran to Martian Times
 ////////////////////////////////////////////////////////////////////////////////
@@ -176,11 +166,9 @@ double UTCstructToTAIfloat(struct timeval *structTime, leapTable *table);
 double J2KtoMSD(double J2K);
 
 /*
- * Converts days since the J2000 epoch (TT) to Mars Sol Date
- * (floating point sols since 1873-12-29)
- * Equation C-2 (modified)
+ * Converts seconds since the Unix epoch (TAI) to Mars Sol Date
  */
-double J2KtoMSD(double J2K);
+double TAItoMSD(double TAI);
 
 ////////////////////////////////////////////////////////////////////////////////
 // Conversions between Martian times
@@ -205,30 +193,58 @@ double LMST(double MSD, double lon);
  * Calculates Local True Solar Time
  * Uses the equation of time to calculate the true solar time based on the
  * position of the sun in the sky at the given time and longitude
+ * Like LMST the result counts sols, the fractional part is the time of day
  * Equation C-5
  */
 double LTST(double MSD, double lon);
 
+/*
+ * Determine subsolar longitude (degrees west, 0 to 360)
+ * Eq. C-5
+ */
+double subsolLon(double MSD);
+
+/*
+ * Splits frac + offset sols, frac in [0, 1), into whole sols (returned) and
+ * whole Martian seconds into the sol (0 to 86399); instants within a
+ * millisecond before a second count as that second
+ * MSDtoSoldate_r, convertAllZones and the Darian calendar all split this way
+ * with frac the fraction of MSD and offset that of the zone, so they agree to
+ * the second
+ */
+long splitSol(double frac, double offset, int *secs);
+
 /*
  * Converts floating point MSD to broken down time with sol, hour, minute,
  * second
+ * The result is malloc'd and must be freed by the caller
  */
-soldate* MSDtoSoldate(double MSD, timeZone *tz);
+soldate* MSDtoSoldate(double MSD, const timeZone *tz);
 
 /*
- * Converts floating point MSD to broken down time representing a date on the
- * Darian Calendar
+ * Converts floating point MSD to broken down time with sol, hour, minute,
+ * second, stored in out
+ * Returns out
  */
-marsCalDate MSDtoDarian(double MSD);
+soldate* MSDtoSoldate_r(double MSD, const timeZone *tz, soldate *out);
 
 /*
  * Returns a pointer to a string representing the date in the format
  * SSSSS HH:MM:SS
  * e.g. MSD 44796 12:34:56 MTC
  *      MSL 0034 14:54:49
+ * The string is malloc'd and must be freed by the caller
  */
 char* soldateToString(soldate *soldate);
 
+/*
+ * Writes the string soldateToString would return into buf, which has room
+ * for cap characters including the terminating null
+ * Returns the length of the string, or -1 (and writes nothing) if it doesn't
+ * fit
+ */
+int soldateFormat(char *buf, size_t cap, const soldate *date);
+
 ////////////////////////////////////////////////////////////////////////////////
 // Martian Orbital Parameters
 ////////////////////////////////////////////////////////////////////////////////
@@ -263,6 +279,61 @@ double EOC(double J2K);
  */
 double Ls(double J2K);
 
+/*
+ * Precision of Ls_precision, EOT_precision and LTST_precision
+ * FAST leaves out the perturbers (B-3) and uses polynomials for sin and cos,
+ * in about a fifth of the time of FULL for Ls and a third for EOT; APPROX
+ * also drops the smallest terms of the equation of center, uses shorter
+ * polynomials for M and turns 2M into 2Ls instead of evaluating sin and cos
+ * of 2Ls, in about two thirds of the time of FAST
+ * The bounds are the largest differences from FULL in Ls and EOT that
+ * marsBench --accuracy found over 1900-2100, rounded up (degrees); 0.025
+ * degrees of EOT are 6 seconds of LTST
+ */
+typedef enum{
+  MARS_PRECISION_FULL, // the same as Ls and EOT
+  MARS_PRECISION_FAST,
+  MARS_PRECISION_APPROX
+} marsPrecision;
+
+#define MARS_PRECISION_FAST_BOUND 0.025
+#define MARS_PRECISION_APPROX_BOUND 0.035
+
+/*
+ * Areocentric solar longitude (degrees) at the given precision
+ */
+double Ls_precision(double J2K, marsPrecision p);
+
+/*
+ * Equation of time (degrees) at the given precision
+ */
+double EOT_precision(double J2K, marsPrecision p);
+
+/*
+ * Local True Solar Time at lon degrees west with the equation of time at the
+ * given precision, see LTST
+ */
+double LTST_precision(double MSD, double lon, marsPrecision p);
+
+/*
+ * Returns the largest error of Ls_precision and EOT_precision at precision p
+ * (degrees), as measured by marsBench --accuracy
+ */
+double marsPrecisionBound(marsPrecision p);
+
+/*
+ * Returns the cheapest precision whose error stays within tol degrees
+ */
+marsPrecision marsPrecisionFor(double tol);
+
+/*
+ * Evaluates Equations B-1 to B-5, C-1, C-5 and D-1 to D-4 at one instant
+ * EOC, Ls, sunLong and sunLat evaluate only the B-series and EOT and
+ * subsolLon only the B- and C-1 series, giving the same values; call this
+ * when more than one of them is needed
+ */
+marsOrbitState computeOrbit(double J2K);
+
 ////////////////////////////////////////////////////////////////////////////////
 // Conversions from Martian to Terran Times
 ////////////////////////////////////////////////////////////////////////////////
@@ -274,12 +345,30 @@ double Ls(double J2K);
  */
 double MSDtoJ2K(double MSD);
 
+/*
+ * Converts Mars Sol Date to seconds since the Unix epoch (TAI)
+ */
+double MSDtoTAI(double MSD);
+
+/*
+ * Converts Mars Sol Date to a UTC timeval struct
+ * Returns out
+ */
+struct timeval* MSDtoUTCstruct(double MSD, leapTable *table,
+    struct timeval *out);
+
+/*
+ * Converts a broken down sol date back to Mars Sol Date, the inverse of
+ * MSDtoSoldate_r (to the second)
+ */
+double soldateToMSD(const soldate *date);
+
 ////////////////////////////////////////////////////////////////////////////////
 // Additional calculations
 ////////////////////////////////////////////////////////////////////////////////
 
 /*
- * Determine solar declination (planetographic)
+ * Determine solar declination (planetographic, deg)
  * Eq. D-1
  */
 double solDec(double Ls);
@@ -303,10 +392,11 @@ double sunLong(double J2K);
 double sunLat(double J2K);
 
 /*
- * Determine local solar elevation
+ * Determine local solar elevation (deg) at planetographic latitude lat and
+ * longitude lon (degrees west)
  * Eq. D-5
  */
-double sunElev(double solDec, double lat, double lon);
+double sunElev(double J2K, double lat, double lon);
 
 /*
  * Determine local solar azimuth (deg)
@@ -315,6 +405,18 @@ double sunElev(double solDec, double lat, double lon);
  * is its azimuth, i.e., compass angle relative to due north.
  * Eq. D-6
  */
-double sunAz(double solDec, double lat, double lon);
+double sunAz(double J2K, double lat, double lon);
+
+/*
+ * Determine local solar elevation and azimuth (deg) for an instant already
+ * evaluated by computeOrbit
+ * Eqs. D-5 and D-6
+ */
+void sunPosition(marsOrbitState orbit, double lat, double lon, double *elev,
+    double *az);
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif
@@ -0,0 +1,86 @@
+/*
+ * Splitting loops over large index ranges across threads
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "parallel.h"
+
+/*
+ * State shared by the threads of one parallelFor call
+ */
+typedef struct{
+  size_t n, grain;
+  atomic_size_t next; // first index not yet handed out
+  parallelBody body;
+  void *arg;
+} parallelJob;
+
+/*
+ * Takes chunks until none are left
+ */
+static void* parallelWorker(void *p){
+  parallelJob *job = p;
+  for(;;){
+    size_t begin = atomic_fetch_add_explicit(&job->next, job->grain,
+        memory_order_relaxed);
+    if(begin >= job->n)
+      break;
+    size_t end = job->n - begin < job->grain ? job->n : begin + job->grain;
+    job->body(begin, end, job->arg);
+  }
+  return NULL;
+}
+
+/*
+ * Returns the number of online CPUs
+ */
+int parallelCPUs(){
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return n > 0 ? n : 1;
+}
+
+/*
+ * Runs body over [0, n) on the given number of threads (0 for one per
+ * online CPU), handing out chunks of grain indices to whichever thread is
+ * free next; body never gets more than grain indices at once, even on one
+ * thread
+ * Returns once every index has been processed
+ */
+void parallelFor(int threads, size_t n, size_t grain, parallelBody body,
+    void *arg){
+  if(grain == 0)
+    grain = 1;
+  if(threads <= 0)
+    threads = parallelCPUs();
+  if((size_t)threads > (n + grain - 1) / grain)
+    threads = (n + grain - 1) / grain;
+  if(threads <= 1){
+    // same chunks as with threads, bodies may size buffers by grain
+    size_t b;
+    for(b=0; b<n; b+=grain)
+      body(b, n - b < grain ? n : b + grain, arg);
+    return;
+  }
+
+  parallelJob job = {.n = n, .grain = grain, .body = body, .arg = arg};
+  atomic_init(&job.next, 0);
+  pthread_t *tids = malloc((threads - 1) * sizeof(pthread_t));
+  if(tids == NULL){
+    printf("Unable to alloc threads\n");
+    exit(1);
+  }
+  int started, i;
+  for(started=0; started<threads-1; started++)
+    if(pthread_create(&tids[started], NULL, parallelWorker, &job) != 0)
+      break;
+  // the calling thread works too, so the loop finishes even if no thread
+  // could be started
+  parallelWorker(&job);
+  for(i=0; i<started; i++)
+    pthread_join(tids[i], NULL);
+  free(tids);
+}
@@ -0,0 +1,30 @@
+/*
+ * Splitting loops over large index ranges across threads
+ */
+
+#ifndef marsparallel
+#define marsparallel
+
+#include <stddef.h>
+
+/*
+ * Body of a parallel loop, called with consecutive ranges [begin, end)
+ */
+typedef void (*parallelBody)(size_t begin, size_t end, void *arg);
+
+/*
+ * Runs body over [0, n) on the given number of threads (0 for one per
+ * online CPU), handing out chunks of grain indices to whichever thread is
+ * free next; body never gets more than grain indices at once, even on one
+ * thread
+ * Returns once every index has been processed
+ */
+void parallelFor(int threads, size_t n, size_t grain, parallelBody body,
+    void *arg);
+
+/*
+ * Returns the number of online CPUs
+ */
+int parallelCPUs();
+
+#endif
@@ -0,0 +1,170 @@
+/*
+ * Global rasters of solar elevation and azimuth
+ *
+ * The hour angle only depends on the column and the latitude terms only on
+ * the row, so their sines and cosines are computed once per grid; each cell
+ * then takes two vectorized multiply-adds, an acos and an atan2. Rows are
+ * shared out between threads.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "raster.h"
+#include "marsTime.h"
+#include "marsSimd.h"
+#include "parallel.h"
+
+/*
+ * Terms shared by all rows of one grid
+ */
+typedef struct{
+  int rows, cols;
+  double sinDec, cosDec, tanDec;
+  double *sinH, *cosH; // per column
+  float *elev, *az;
+} illumJob;
+
+/*
+ * Returns the number of rows of a global grid with cells res degrees on a side
+ */
+int rasterRows(double res){
+  return lround(180 / res);
+}
+
+/*
+ * Returns the number of columns of a global grid with cells res degrees on a
+ * side
+ */
+int rasterCols(double res){
+  return lround(360 / res);
+}
+
+/*
+ * Fills in rows [begin, end) of the grid
+ */
+static void illumRowsBody(size_t begin, size_t end, void *arg){
+  illumJob *job = arg;
+  int cols = job->cols;
+  double *cosZ = malloc(2 * cols * sizeof(double));
+  if(cosZ == NULL){
+    printf("Unable to alloc raster row\n");
+    exit(1);
+  }
+  double *x = cosZ + cols;
+  size_t r;
+  for(r=begin; r<end; r++){
+    double lat = (90 - (r + 0.5) * 180 / job->rows) * DEG;
+    double sinLat = sin(lat);
+    double cosLat = cos(lat);
+    // Eq. D-5: cos Z = sin dec sin lat + cos dec cos lat cos H
+    // Eq. D-6: Az = atan2(sin H, cos lat tan dec - sin lat cos H)
+    vdouble va = vset(job->sinDec * sinLat);
+    vdouble vb = vset(job->cosDec * cosLat);
+    vdouble vc = vset(cosLat * job->tanDec);
+    vdouble vd = vset(-sinLat);
+    int c = 0;
+    for(; c + SIMD_WIDTH <= cols; c += SIMD_WIDTH){
+      vdouble cosH = vload(job->cosH + c);
+      vstore(cosZ + c, vfmadd(vb, cosH, va));
+      vstore(x + c, vfmadd(vd, cosH, vc));
+    }
+    for(; c < cols; c++){
+      cosZ[c] = sfmadd(job->cosDec * cosLat, job->cosH[c], job->sinDec * sinLat);
+      x[c] = sfmadd(-sinLat, job->cosH[c], cosLat * job->tanDec);
+    }
+
+    float *elev = job->elev + r * cols;
+    float *az = job->az + r * cols;
+    for(c=0; c<cols; c++){
+      double z = cosZ[c] > 1 ? 1 : cosZ[c] < -1 ? -1 : cosZ[c];
+      elev[c] = 90 - acos(z) / DEG;
+      double a = atan2(job->sinH[c], x[c]) / DEG;
+      az[c] = a < 0 ? a + 360 : a;
+    }
+  }
+  free(cosZ);
+}
+
+/*
+ * Computes solar elevation and azimuth (deg) at the centres of the cells of
+ * a global grid with cells res degrees on a side, using the given number of
+ * threads (0 for all CPUs)
+ * elev and az need room for rasterRows(res)*rasterCols(res) values
+ */
+void illumGrid(double J2K, double res, int threads, float *elev, float *az){
+  marsOrbitState orbit = computeOrbit(J2K);
+  illumJob job;
+  job.rows = rasterRows(res);
+  job.cols = rasterCols(res);
+  job.sinDec = sin(orbit.solDec * DEG);
+  job.cosDec = cos(orbit.solDec * DEG);
+  job.tanDec = tan(orbit.solDec * DEG);
+  job.elev = elev;
+  job.az = az;
+  job.sinH = malloc(2 * job.cols * sizeof(double));
+  if(job.sinH == NULL){
+    printf("Unable to alloc raster columns\n");
+    exit(1);
+  }
+  job.cosH = job.sinH + job.cols;
+  int c;
+  for(c=0; c<job.cols; c++){
+    double lon = (c + 0.5) * 360 / job.cols;
+    double H = (lon - orbit.subsolLon) * DEG;
+    job.sinH[c] = sin(H);
+    job.cosH[c] = cos(H);
+  }
+  parallelFor(threads, job.rows, 4, illumRowsBody, &job);
+  free(job.sinH);
+}
+
+/*
+ * Writes a raster file with count grids, starting at J2K and step seconds
+ * apart
+ * Returns 0 on success
+ */
+int illumRaster(const char *path, double J2K, double step, int count,
+    double res, int threads){
+  int rows = rasterRows(res);
+  int cols = rasterCols(res);
+  if(rows <= 0 || cols <= 0 || count <= 0)
+    return 1;
+  size_t cells = (size_t)rows * cols;
+  float *grid = malloc(2 * cells * sizeof(float));
+  double *times = calloc((count + 7) & ~7, sizeof(double));
+  if(grid == NULL || times == NULL){
+    printf("Unable to alloc raster\n");
+    exit(1);
+  }
+  FILE *fp = fopen(path, "wb");
+  if(fp == NULL){
+    printf("Cannot open file \"%s\"\n", path);
+    free(grid);
+    free(times);
+    return 1;
+  }
+
+  rasterHeader h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, "MTRASTR1", 8);
+  h.version = 1;
+  h.rows = rows;
+  h.cols = cols;
+  h.count = count;
+  h.res = res;
+  int i;
+  for(i=0; i<count; i++)
+    times[i] = J2K + i * step / 86400;
+  int err = fwrite(&h, sizeof(h), 1, fp) != 1 ||
+    fwrite(times, sizeof(double), (count + 7) & ~7, fp) != (size_t)((count + 7) & ~7);
+  for(i=0; i<count && !err; i++){
+    illumGrid(times[i], res, threads, grid, grid + cells);
+    err = fwrite(grid, sizeof(float), 2 * cells, fp) != 2 * cells;
+  }
+  if(fclose(fp) != 0)
+    err = 1;
+  free(grid);
+  free(times);
+  return err;
+}
@@ -0,0 +1,50 @@
+/*
+ * Global rasters of solar elevation and azimuth
+ */
+
+#ifndef marsraster
+#define marsraster
+
+#include <stdint.h>
+
+/*
+ * Layout of the start of a raster file
+ * The header is followed by count doubles holding the instants (J2K),
+ * padded to a multiple of 64 bytes, then for each instant rows*cols floats
+ * of elevation followed by rows*cols floats of azimuth (deg), row by row
+ * from north to south, each row from 0 degrees westward
+ * All values use the byte order of the machine writing the file
+ */
+typedef struct{
+  char magic[8]; // "MTRASTR1"
+  uint32_t version;
+  uint32_t rows, cols;
+  uint32_t count; // number of instants
+  double res; // cell size (deg)
+  uint8_t pad[32];
+} rasterHeader;
+
+/*
+ * Returns the number of rows and columns of a global grid with cells res
+ * degrees on a side
+ */
+int rasterRows(double res);
+int rasterCols(double res);
+
+/*
+ * Computes solar elevation and azimuth (deg) at the centres of the cells of
+ * a global grid with cells res degrees on a side, using the given number of
+ * threads (0 for all CPUs)
+ * elev and az need room for rasterRows(res)*rasterCols(res) values
+ */
+void illumGrid(double J2K, double res, int threads, float *elev, float *az);
+
+/*
+ * Writes a raster file with count grids, starting at J2K and step seconds
+ * apart
+ * Returns 0 on success
+ */
+int illumRaster(const char *path, double J2K, double step, int count,
+    double res, int threads);
+
+#endif
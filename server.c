@@ -0,0 +1,375 @@
+/*
+ * Conversion daemon answering fixed size binary requests on a Unix domain
+ * socket
+ *
+ * Each worker thread has its own epoll instance. The listening socket is
+ * added to all of them with EPOLLEXCLUSIVE, and a connection stays with the
+ * worker that accepted it, so connections need no locking. A connection reads
+ * as many requests as fit in its buffer, answers all of them with one batch
+ * conversion per kind and writes the responses with one send; while
+ * responses are still waiting to be sent no more requests are read.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "server.h"
+#include "marsBatch.h"
+#include "parallel.h"
+
+#define MAXEVENTS 64
+#define MAXWORKERS 4
+// requests read at a time by one connection
+#define CONNREQS 2048
+#define INBUF (CONNREQS * sizeof(serverRequest))
+#define OUTBUF (CONNREQS * sizeof(serverResponse))
+
+/*
+ * Buffers of one client connection
+ */
+typedef struct{
+  int fd;
+  size_t inLen; // bytes waiting in in
+  size_t outLen, outOff; // bytes in out, and how many of them were sent
+  char in[INBUF];
+  char out[OUTBUF];
+} serverConn;
+
+/*
+ * Requests of one read of a connection, gathered so that each kind of
+ * conversion is done with one batch call
+ */
+typedef struct{
+  serverResponse resp[CONNREQS];
+  const timeZone *tz[CONNREQS]; // zone of a sol date request, else NULL
+  int64_t sec[CONNREQS];
+  int32_t usec[CONNREQS];
+  double msd[CONNREQS];
+  uint32_t idx[CONNREQS]; // response each element of the arrays above is for
+} serverBatch;
+
+/*
+ * State of one worker thread
+ */
+typedef struct{
+  int epfd;
+  int listenfd;
+  leapSource *leap;
+  const zoneRegistry *registry;
+  serverBatch *batch; // used by one connection at a time
+} serverWorker;
+
+/*
+ * Starts the response to req in b->resp[i]: copies the id and checks the
+ * operation and zone, setting b->tz[i] for sol date requests
+ * Returns 1 if the request is valid
+ */
+static int startAnswer(const serverWorker *w, const serverRequest *req,
+    serverBatch *b, size_t i){
+  serverResponse *resp = &b->resp[i];
+  memset(resp, 0, sizeof(*resp));
+  resp->id = req->id;
+  b->tz[i] = NULL;
+  if(req->op < SERVER_UTC_TO_MSD || req->op > SERVER_MSD_TO_SOLDATE){
+    resp->status = SERVER_BAD_OP;
+    return 0;
+  }
+  if(req->op == SERVER_UTC_TO_SOLDATE || req->op == SERVER_MSD_TO_SOLDATE){
+    if(req->zone >= w->registry->size){
+      resp->status = SERVER_BAD_ZONE;
+      return 0;
+    }
+    b->tz[i] = w->registry->zones[req->zone];
+  }
+  return 1;
+}
+
+/*
+ * Answers the count requests at in into b->resp, with one UTCtoMSD_batch
+ * call for all UTC requests and one MSDtoUTC_batch call for all MSD to UTC
+ * requests
+ */
+static void answer(const serverWorker *w, leapTable *table, const char *in,
+    size_t count, serverBatch *b){
+  size_t i, n = 0;
+  serverRequest req;
+  // UTC to MSD, for sol dates too
+  for(i=0; i<count; i++){
+    memcpy(&req, in + i * sizeof(req), sizeof(req));
+    if(!startAnswer(w, &req, b, i))
+      continue;
+    if(req.op == SERVER_UTC_TO_MSD || req.op == SERVER_UTC_TO_SOLDATE){
+      b->resp[i].sec = req.sec;
+      b->resp[i].usec = req.usec;
+      b->sec[n] = req.sec;
+      b->usec[n] = req.usec;
+      b->idx[n++] = i;
+    }else
+      b->resp[i].msd = req.msd;
+  }
+  UTCtoMSD_batch(b->sec, b->usec, b->msd, n, table);
+  for(i=0; i<n; i++)
+    b->resp[b->idx[i]].msd = b->msd[i];
+  // MSD to UTC
+  n = 0;
+  for(i=0; i<count; i++){
+    memcpy(&req, in + i * sizeof(req), sizeof(req));
+    if(req.op == SERVER_MSD_TO_UTC){
+      b->msd[n] = req.msd;
+      b->idx[n++] = i;
+    }
+  }
+  MSDtoUTC_batch(b->msd, b->sec, b->usec, n, table);
+  for(i=0; i<n; i++){
+    b->resp[b->idx[i]].sec = b->sec[i];
+    b->resp[b->idx[i]].usec = b->usec[i];
+  }
+  // sol dates need no leap table
+  for(i=0; i<count; i++){
+    if(b->tz[i] == NULL)
+      continue;
+    soldate date;
+    MSDtoSoldate_r(b->resp[i].msd, b->tz[i], &date);
+    b->resp[i].sol = date.sol;
+    b->resp[i].hour = date.hour;
+    b->resp[i].min = date.min;
+    b->resp[i].second = date.sec;
+  }
+}
+
+/*
+ * Sends what is left of the responses of conn
+ * Returns -1 if the connection failed, 0 otherwise
+ */
+static int flushConn(serverConn *conn){
+  while(conn->outOff < conn->outLen){
+    ssize_t n = send(conn->fd, conn->out + conn->outOff,
+        conn->outLen - conn->outOff, MSG_NOSIGNAL);
+    if(n < 0){
+      if(errno == EINTR)
+        continue;
+      if(errno == EAGAIN || errno == EWOULDBLOCK)
+        return 0;
+      return -1;
+    }
+    conn->outOff += n;
+  }
+  conn->outLen = 0;
+  conn->outOff = 0;
+  return 0;
+}
+
+/*
+ * Answers the complete requests waiting in conn and sends the responses
+ * Returns -1 if the connection failed, 0 otherwise
+ */
+static int answerConn(const serverWorker *w, serverConn *conn){
+  size_t count = conn->inLen / sizeof(serverRequest);
+  leapGuard guard;
+  leapTable *table = leapAcquire(w->leap, &guard);
+  answer(w, table, conn->in, count, w->batch);
+  leapRelease(&guard);
+  memcpy(conn->out + conn->outLen, w->batch->resp,
+      count * sizeof(serverResponse));
+  conn->outLen += count * sizeof(serverResponse);
+  size_t used = count * sizeof(serverRequest);
+  conn->inLen -= used;
+  memmove(conn->in, conn->in + used, conn->inLen);
+  return flushConn(conn);
+}
+
+/*
+ * Waits for input on conn if all responses were sent, for output otherwise
+ */
+static int watchConn(const serverWorker *w, serverConn *conn){
+  struct epoll_event ev;
+  ev.events = conn->outLen > 0 ? EPOLLOUT : EPOLLIN;
+  ev.data.ptr = conn;
+  return epoll_ctl(w->epfd, EPOLL_CTL_MOD, conn->fd, &ev);
+}
+
+/*
+ * Closes conn and frees its buffers
+ */
+static void closeConn(serverConn *conn){
+  close(conn->fd);
+  free(conn);
+}
+
+/*
+ * Handles readiness of conn
+ * Returns -1 if the connection is finished
+ */
+static int serviceConn(const serverWorker *w, serverConn *conn,
+    uint32_t events){
+  int wasWriting = conn->outLen > 0;
+  if(wasWriting){
+    if(flushConn(conn) != 0)
+      return -1;
+    if(conn->outLen > 0)
+      return 0;
+    // sent everything, answer requests that were left waiting
+    if(answerConn(w, conn) != 0)
+      return -1;
+    return watchConn(w, conn);
+  }
+  if(events & (EPOLLERR | EPOLLHUP) && !(events & EPOLLIN))
+    return -1;
+  ssize_t n;
+  do
+    n = read(conn->fd, conn->in + conn->inLen, INBUF - conn->inLen);
+  while(n < 0 && errno == EINTR);
+  if(n == 0)
+    return -1;
+  if(n < 0)
+    return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+  conn->inLen += n;
+  if(answerConn(w, conn) != 0)
+    return -1;
+  if(conn->outLen > 0)
+    return watchConn(w, conn);
+  return 0;
+}
+
+/*
+ * Accepts waiting connections and adds them to the worker's epoll instance
+ */
+static void acceptConns(const serverWorker *w){
+  for(;;){
+    int fd = accept4(w->listenfd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if(fd < 0)
+      return;
+    serverConn *conn = malloc(sizeof(serverConn));
+    if(conn == NULL){
+      close(fd);
+      return;
+    }
+    conn->fd = fd;
+    conn->inLen = 0;
+    conn->outLen = 0;
+    conn->outOff = 0;
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = conn;
+    if(epoll_ctl(w->epfd, EPOLL_CTL_ADD, fd, &ev) != 0)
+      closeConn(conn);
+  }
+}
+
+/*
+ * Event loop of one worker thread
+ */
+static void* serverLoop(void *p){
+  serverWorker *w = p;
+  struct epoll_event events[MAXEVENTS];
+  for(;;){
+    int n = epoll_wait(w->epfd, events, MAXEVENTS, -1);
+    int i;
+    for(i=0; i<n; i++){
+      serverConn *conn = events[i].data.ptr;
+      if(conn == NULL)
+        acceptConns(w);
+      else if(serviceConn(w, conn, events[i].events) != 0)
+        closeConn(conn);
+    }
+  }
+  return NULL;
+}
+
+/*
+ * Creates a listening socket at path, replacing an old socket there
+ * Returns the socket, or -1 on error
+ */
+static int listenAt(const char *path){
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if(strlen(path) >= sizeof(addr.sun_path)){
+    fprintf(stderr, "Socket path \"%s\" is too long\n", path);
+    return -1;
+  }
+  strcpy(addr.sun_path, path);
+  struct stat st;
+  if(lstat(path, &st) == 0){
+    if(!S_ISSOCK(st.st_mode)){
+      fprintf(stderr, "\"%s\" exists and is not a socket\n", path);
+      return -1;
+    }
+    unlink(path);
+  }
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if(fd < 0)
+    return -1;
+  if(bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+      listen(fd, SOMAXCONN) != 0){
+    fprintf(stderr, "Cannot listen on \"%s\"\n", path);
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/*
+ * Answers requests on a socket created at path until SIGINT or SIGTERM,
+ * using the given number of worker threads (0 for one per CPU, at most 4)
+ * An existing socket at path is replaced, and removed again on exit
+ * Returns nonzero if the socket can't be set up
+ */
+int serveSocket(const char *path, leapSource *leap,
+    const zoneRegistry *registry, int threads){
+  if(threads <= 0){
+    threads = parallelCPUs();
+    if(threads > MAXWORKERS)
+      threads = MAXWORKERS;
+  }
+  int listenfd = listenAt(path);
+  if(listenfd < 0)
+    return 1;
+
+  // the workers inherit the mask, so only sigwait below sees the signals
+  sigset_t stop;
+  sigemptyset(&stop);
+  sigaddset(&stop, SIGINT);
+  sigaddset(&stop, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &stop, NULL);
+
+  serverWorker *workers = malloc(threads * sizeof(serverWorker));
+  serverBatch *batches = malloc(threads * sizeof(serverBatch));
+  if(workers == NULL || batches == NULL){
+    fprintf(stderr, "Unable to alloc server workers\n");
+    exit(1);
+  }
+  int i;
+  for(i=0; i<threads; i++){
+    serverWorker *w = &workers[i];
+    w->listenfd = listenfd;
+    w->leap = leap;
+    w->registry = registry;
+    w->batch = &batches[i];
+    w->epfd = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLEXCLUSIVE;
+    ev.data.ptr = NULL;
+    pthread_t thread;
+    if(w->epfd < 0 || epoll_ctl(w->epfd, EPOLL_CTL_ADD, listenfd, &ev) != 0 ||
+        pthread_create(&thread, NULL, serverLoop, w) != 0){
+      fprintf(stderr, "Cannot start server worker\n");
+      unlink(path);
+      exit(1);
+    }
+    pthread_detach(thread);
+  }
+
+  int sig;
+  sigwait(&stop, &sig);
+  close(listenfd);
+  unlink(path);
+  return 0;
+}
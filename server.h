@@ -0,0 +1,76 @@
+/*
+ * Conversion daemon answering fixed size binary requests on a Unix domain
+ * socket
+ *
+ * Clients write serverRequest records and read back one serverResponse per
+ * request, in the same order; any number of requests may be written before
+ * reading the responses. Both records use the byte order of the machine,
+ * which is fine for a socket that only local processes can reach.
+ */
+
+#ifndef marsserver
+#define marsserver
+
+#include <stdint.h>
+#include "leapSource.h"
+#include "zones.h"
+
+/*
+ * Operations a request can ask for
+ */
+enum serverOp{
+  SERVER_UTC_TO_MSD = 1, // sec/usec -> msd
+  SERVER_MSD_TO_UTC = 2, // msd -> sec/usec
+  SERVER_UTC_TO_SOLDATE = 3, // sec/usec -> msd and the sol date in zone
+  SERVER_MSD_TO_SOLDATE = 4 // msd -> the sol date in zone
+};
+
+/*
+ * Values of serverResponse.status
+ */
+enum serverStatus{
+  SERVER_OK = 0,
+  SERVER_BAD_OP = 1, // unknown op
+  SERVER_BAD_ZONE = 2 // zone is not an index into the registry
+};
+
+/*
+ * One request, 32 bytes
+ */
+typedef struct{
+  uint32_t id; // copied to the response
+  uint16_t op; // enum serverOp
+  uint16_t zone; // index of the zone in the server's registry, in the order
+                 // --all-zones prints them
+  int64_t sec; // UTC seconds since the Unix epoch
+  int32_t usec; // microseconds
+  uint32_t pad;
+  double msd; // Mars Sol Date
+} serverRequest;
+
+/*
+ * One response, 40 bytes; fields the operation doesn't produce are 0
+ */
+typedef struct{
+  uint32_t id; // id of the request
+  int32_t status; // enum serverStatus
+  int64_t sec; // UTC seconds since the Unix epoch
+  int32_t usec; // microseconds
+  uint8_t hour, min, second; // time of day in the zone
+  uint8_t pad;
+  double msd; // Mars Sol Date
+  int64_t sol; // sol number in the zone
+} serverResponse;
+
+/*
+ * Answers requests on a socket created at path until SIGINT or SIGTERM,
+ * using the given number of worker threads (0 for one per CPU, at most 4)
+ * An existing socket at path is replaced, and removed again on exit
+ * The current table of leap is used for each batch of requests, so reloads
+ * take effect without a restart
+ * Returns nonzero if the socket can't be set up
+ */
+int serveSocket(const char *path, leapSource *leap,
+    const zoneRegistry *registry, int threads);
+
+#endif
@@ -0,0 +1,237 @@
+/*
+ * Streaming conversion of UTC timestamps, one per line, to Mars time
+ *
+ * Input is read in large blocks and parsed in place; timestamps are collected
+ * into arrays and converted with UTCtoMSD_batch, and the output lines are
+ * assembled in a large buffer which is written out when full. Nothing is
+ * allocated or printf'd per line.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include "stream.h"
+#include "marsBatch.h"
+#include "timestamp.h"
+
+#define INBUF (1 << 20)
+#define OUTBUF (1 << 20)
+// longest output line: MSD, sol date and newline
+#define MAXLINE 256
+// timestamps converted at a time
+#define BLOCK 4096
+
+/*
+ * Buffers and pending timestamps of one conversion
+ */
+typedef struct{
+  int outfd;
+  leapTable *table;
+  const timeZone *tz;
+  streamStats *stats;
+  size_t nblock; // timestamps waiting in sec/usec
+  size_t outlen; // bytes waiting in out
+  int64_t sec[BLOCK];
+  int32_t usec[BLOCK];
+  char valid[BLOCK];
+  double msd[BLOCK];
+  char out[OUTBUF];
+  char in[INBUF];
+} streamState;
+
+/*
+ * Returns the current time of the monotonic clock in seconds
+ */
+static double monotonic(){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Writes all of buf to fd
+ */
+static int writeAll(int fd, const char *buf, size_t len){
+  while(len > 0){
+    ssize_t n = write(fd, buf, len);
+    if(n < 0){
+      if(errno == EINTR)
+        continue;
+      return 1;
+    }
+    buf += n;
+    len -= n;
+  }
+  return 0;
+}
+
+/*
+ * Writes val to p with at least digits digits, zero padded, and returns the
+ * position after it
+ */
+static char* putUnsigned(char *p, uint64_t val, int digits){
+  char tmp[20];
+  int n = 0;
+  do{
+    tmp[n++] = '0' + val % 10;
+    val /= 10;
+  }while(val != 0);
+  while(n < digits)
+    tmp[n++] = '0';
+  while(n > 0)
+    *p++ = tmp[--n];
+  return p;
+}
+
+/*
+ * Formats one output line for the given MSD into p, which has room for at
+ * least MAXLINE characters, and returns its end
+ */
+static char* formatLine(char *p, double msd, const timeZone *tz){
+  int64_t micro = llround(msd * 1e6);
+  if(micro < 0){
+    *p++ = '-';
+    micro = -micro;
+  }
+  p = putUnsigned(p, micro / 1000000, 1);
+  *p++ = '.';
+  p = putUnsigned(p, micro % 1000000, 6);
+  *p++ = ' ';
+
+  soldate date;
+  MSDtoSoldate_r(msd, tz, &date);
+  int len = soldateFormat(p, MAXLINE - 40, &date);
+  if(len < 0){
+    memcpy(p, "?", 1);
+    len = 1;
+  }
+  p += len;
+  *p++ = '\n';
+  return p;
+}
+
+/*
+ * Converts and writes out the pending timestamps
+ */
+static int flushBlock(streamState *st){
+  size_t i;
+  UTCtoMSD_batch(st->sec, st->usec, st->msd, st->nblock, st->table);
+  for(i=0; i<st->nblock; i++){
+    if(st->outlen > OUTBUF - MAXLINE){
+      if(writeAll(st->outfd, st->out, st->outlen) != 0)
+        return 1;
+      st->stats->bytesOut += st->outlen;
+      st->outlen = 0;
+    }
+    char *p = st->out + st->outlen;
+    if(st->valid[i])
+      p = formatLine(p, st->msd[i], st->tz);
+    else{
+      memcpy(p, "invalid\n", 8);
+      p += 8;
+    }
+    st->outlen = p - st->out;
+  }
+  st->nblock = 0;
+  return 0;
+}
+
+/*
+ * Reads UTC timestamps from infd, one per line, and writes a line
+ *   MSD SOLDATE
+ * e.g. 49269.245017 MSL 0000 15:11:41
+ * for each of them to outfd, using the given time zone for the sol date
+ * Accepts the ISO-8601, RFC 3339 and Unix seconds timestamps of
+ * parseTimestamp
+ * Lines that cannot be parsed produce the line "invalid"
+ * Returns 0 on success, nonzero on a read or write error
+ */
+int streamConvert(int infd, int outfd, leapTable *table,
+    const timeZone *tz, streamStats *stats){
+  streamState *st = malloc(sizeof(streamState));
+  if(st == NULL){
+    printf("Unable to alloc stream buffers\n");
+    exit(1);
+  }
+  st->outfd = outfd;
+  st->table = table;
+  st->tz = tz;
+  st->stats = stats;
+  st->nblock = 0;
+  st->outlen = 0;
+  memset(stats, 0, sizeof(streamStats));
+  double started = monotonic();
+
+  int err = 0;
+  size_t have = 0; // bytes of an unfinished line at the start of st->in
+  int eof = 0;
+  int skip = 0; // dropping the rest of an overlong line
+  while(!eof && !err){
+    ssize_t n = read(infd, st->in + have, INBUF - have);
+    if(n < 0){
+      if(errno == EINTR)
+        continue;
+      err = 1;
+      break;
+    }
+    if(n == 0){
+      eof = 1;
+      // a last line without a newline
+      if(have > 0)
+        st->in[have++] = '\n';
+    }
+    stats->bytesIn += n;
+    have += n;
+
+    const char *p = st->in;
+    const char *end = st->in + have;
+    const char *nl;
+    while((nl = memchr(p, '\n', end - p)) != NULL){
+      if(skip)
+        skip = 0;
+      else if(nl > p){
+        size_t i = st->nblock++;
+        st->valid[i] = parseTimestamp(p, nl - p, &st->sec[i], &st->usec[i]);
+        if(!st->valid[i]){
+          st->sec[i] = 0;
+          st->usec[i] = 0;
+          stats->invalid++;
+        }
+        stats->lines++;
+        if(st->nblock == BLOCK && flushBlock(st) != 0){
+          err = 1;
+          break;
+        }
+      }
+      p = nl + 1;
+    }
+    have = end - p;
+    if(have == INBUF && !err){
+      // a line longer than the whole buffer can't be a timestamp, drop it
+      // and what is left of it in the next read
+      if(!skip){
+        size_t i = st->nblock++;
+        st->valid[i] = 0;
+        st->sec[i] = 0;
+        st->usec[i] = 0;
+        stats->lines++;
+        stats->invalid++;
+        if(st->nblock == BLOCK && flushBlock(st) != 0)
+          err = 1;
+      }
+      skip = 1;
+      have = 0;
+    }
+    memmove(st->in, p, have);
+  }
+
+  if(!err && st->nblock > 0)
+    err = flushBlock(st);
+  if(!err && st->outlen > 0){
+    err = writeAll(outfd, st->out, st->outlen);
+    stats->bytesOut += st->outlen;
+  }
+  stats->seconds = monotonic() - started;
+  free(st);
+  return err;
+}
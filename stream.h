@@ -0,0 +1,35 @@
+/*
+ * Streaming conversion of UTC timestamps, one per line, to Mars time
+ */
+
+#ifndef marsstream
+#define marsstream
+
+#include <stddef.h>
+#include <stdint.h>
+#include "marsTime.h"
+
+/*
+ * Counters filled in by streamConvert
+ */
+typedef struct{
+  uint64_t lines; // lines read
+  uint64_t invalid; // lines that could not be parsed
+  uint64_t bytesIn, bytesOut;
+  double seconds; // wall clock time spent converting
+} streamStats;
+
+/*
+ * Reads UTC timestamps from infd, one per line, and writes a line
+ *   MSD SOLDATE
+ * e.g. 49269.245017 MSL 0000 15:11:41
+ * for each of them to outfd, using the given time zone for the sol date
+ * Accepts the ISO-8601, RFC 3339 and Unix seconds timestamps of
+ * parseTimestamp
+ * Lines that cannot be parsed produce the line "invalid"
+ * Returns 0 on success, nonzero on a read or write error
+ */
+int streamConvert(int infd, int outfd, leapTable *table,
+    const timeZone *tz, streamStats *stats);
+
+#endif
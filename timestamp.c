@@ -0,0 +1,237 @@
+/*
+ * Parser of UTC timestamps: ISO-8601 and RFC 3339 dates and times, and
+ * seconds since the Unix epoch
+ */
+
+#include "timestamp.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// YYYY-MM-DDTHH:MM: each character is XORed with the template, which turns
+// digits into their value and correct separators into 0, and must then be at
+// most the limit; the date and time separator has its own check
+static const uint8_t fixedTemplate[16] = {
+  '0', '0', '0', '0', '-', '0', '0', '-', '0', '0', 0, '0', '0', ':', '0', '0'
+};
+static const uint8_t fixedLimit[16] = {
+  9, 9, 9, 9, 0, 9, 9, 0, 9, 9, 255, 9, 9, 0, 9, 9
+};
+
+/*
+ * Checks the 16 characters YYYY-MM-DD?HH:MM at p and stores the value of each
+ * digit into d (separators become 0)
+ * Returns 1 if every digit and separator is in place
+ */
+static inline int fixedFields(const char *p, uint8_t *d){
+#if defined(__SSE2__)
+  __m128i tmpl = _mm_loadu_si128((const __m128i *)fixedTemplate);
+  __m128i limit = _mm_loadu_si128((const __m128i *)fixedLimit);
+  __m128i x = _mm_xor_si128(_mm_loadu_si128((const __m128i *)p), tmpl);
+  __m128i over = _mm_subs_epu8(x, limit);
+  if(_mm_movemask_epi8(_mm_cmpeq_epi8(over, _mm_setzero_si128())) != 0xffff)
+    return 0;
+  _mm_storeu_si128((__m128i *)d, x);
+  return 1;
+#else
+  int i;
+  for(i=0; i<16; i++){
+    d[i] = (uint8_t)p[i] ^ fixedTemplate[i];
+    if(d[i] > fixedLimit[i])
+      return 0;
+  }
+  return 1;
+#endif
+}
+
+/*
+ * Parses n digits, returns -1 if any of them is not a digit
+ */
+static inline int parseDigits(const char *p, int n){
+  int val = 0;
+  int i;
+  for(i=0; i<n; i++){
+    unsigned d = p[i] - '0';
+    if(d > 9)
+      return -1;
+    val = val*10 + d;
+  }
+  return val;
+}
+
+/*
+ * Parses the digits of a fraction of a second as microseconds, ignoring any
+ * past the sixth
+ * Returns the position after the digits
+ */
+static const char* parseMicro(const char *p, const char *end, int32_t *usec){
+  int32_t val = 0;
+  int n = 0;
+  while(p < end && (unsigned)(*p - '0') <= 9){
+    if(n < 6){
+      val = val*10 + (*p - '0');
+      n++;
+    }
+    p++;
+  }
+  static const int32_t scale[7] = {1000000, 100000, 10000, 1000, 100, 10, 1};
+  *usec = val * scale[n];
+  return p;
+}
+
+/*
+ * Returns the number of days from 1970-01-01 to the given proleptic
+ * Gregorian date
+ */
+static int64_t daysFromCivil(int64_t y, int m, int d){
+  y -= m <= 2;
+  int64_t era = (y >= 0 ? y : y - 399) / 400;
+  int64_t yoe = y - era * 400;
+  int64_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + doe - 719468;
+}
+
+/*
+ * Returns the number of days in month of year
+ */
+static inline int monthLength(int year, int month){
+  static const uint8_t days[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31,
+    30, 31};
+  if(month == 2)
+    return 28 + (year % 4 == 0 && (year % 100 != 0 || year % 400 == 0));
+  return days[month - 1];
+}
+
+/*
+ * Parses an ISO-8601 date and optional time in [p, end)
+ * Returns 1 if that is all there is
+ */
+static int parseISO(const char *p, const char *end, int64_t *sec,
+    int32_t *usec){
+  int year, month, day, hour = 0, min = 0, s = 0;
+  int32_t micro = 0;
+  int64_t offset = 0;
+  uint8_t d[16];
+  if(end - p >= 16 && fixedFields(p, d) &&
+      (p[10] == 'T' || p[10] == 't' || p[10] == ' ')){
+    year = d[0] * 1000 + d[1] * 100 + d[2] * 10 + d[3];
+    month = d[5] * 10 + d[6];
+    day = d[8] * 10 + d[9];
+    hour = d[11] * 10 + d[12];
+    min = d[14] * 10 + d[15];
+    p += 16;
+    if(p < end && *p == ':'){
+      if(end - p < 3 || (s = parseDigits(p+1, 2)) < 0)
+        return 0;
+      p += 3;
+      if(p < end && (*p == '.' || *p == ',')){
+        const char *digits = p + 1;
+        p = parseMicro(digits, end, &micro);
+        if(p == digits)
+          return 0;
+      }
+    }
+    if(p < end){
+      if(*p == 'Z' || *p == 'z')
+        p++;
+      else if(*p == '+' || *p == '-'){
+        int sign = *p == '-' ? -1 : 1;
+        int oh, om = 0;
+        if(end - p < 3 || (oh = parseDigits(p+1, 2)) < 0)
+          return 0;
+        p += 3;
+        // minutes are optional, but a colon must be followed by them
+        int colon = p < end && *p == ':';
+        p += colon;
+        if(p < end || colon){
+          if(end - p < 2 || (om = parseDigits(p, 2)) < 0)
+            return 0;
+          p += 2;
+        }
+        if(oh > 23 || om > 59)
+          return 0;
+        offset = sign * (oh * 3600 + om * 60);
+      }
+    }
+  }else{
+    // date only
+    if(end - p != 10 || p[4] != '-' || p[7] != '-')
+      return 0;
+    year = parseDigits(p, 4);
+    month = parseDigits(p+5, 2);
+    day = parseDigits(p+8, 2);
+    if(year < 0 || month < 0 || day < 0)
+      return 0;
+    p += 10;
+  }
+  if(p != end || month < 1 || month > 12 || day < 1 ||
+      day > monthLength(year, month) || hour > 23 || min > 59 || s > 60)
+    return 0;
+  *sec = (daysFromCivil(year, month, day)*24 + hour)*3600 + min*60 + s -
+    offset;
+  *usec = micro;
+  return 1;
+}
+
+/*
+ * Parses seconds since the Unix epoch in [p, end)
+ * Returns 1 if that is all there is
+ */
+static int parseEpoch(const char *p, const char *end, int64_t *sec,
+    int32_t *usec){
+  if(p < end && *p == '@')
+    p++;
+  int neg = 0;
+  if(p < end && (*p == '-' || *p == '+'))
+    neg = *p++ == '-';
+  const char *digits = p;
+  int64_t val = 0;
+  while(p < end && (unsigned)(*p - '0') <= 9 && p - digits < 18)
+    val = val*10 + (*p++ - '0');
+  if(p == digits)
+    return 0;
+  int32_t micro = 0;
+  if(p < end && *p == '.'){
+    digits = p + 1;
+    p = parseMicro(digits, end, &micro);
+    if(p == digits)
+      return 0;
+  }
+  if(p != end)
+    return 0;
+  if(neg){
+    val = -val;
+    if(micro != 0){
+      val -= 1;
+      micro = 1000000 - micro;
+    }
+  }
+  *sec = val;
+  *usec = micro;
+  return 1;
+}
+
+/*
+ * Parses the timestamp in the len characters at str into UTC seconds since
+ * the Unix epoch and microseconds; blanks around it are skipped
+ * Accepts
+ *   YYYY-MM-DD[(T|t| )HH:MM[:SS[(.|,)FRACTION]][Z|z|(+|-)HH[[:]MM]]]
+ *   [@][+|-]SECONDS[.FRACTION]
+ * Times without an offset are UTC. A second of 60 is an inserted leap second
+ * and counts like the first second of the next minute; digits of a fraction
+ * past the sixth are dropped
+ * Returns 1 on success, 0 if str is not a timestamp
+ */
+int parseTimestamp(const char *str, size_t len, int64_t *sec, int32_t *usec){
+  const char *p = str, *end = str + len;
+  while(p < end && (*p == ' ' || *p == '\t'))
+    p++;
+  while(end > p && (end[-1] == '\r' || end[-1] == '\n' || end[-1] == ' ' ||
+        end[-1] == '\t'))
+    end--;
+  if(end - p >= 10 && p[4] == '-')
+    return parseISO(p, end, sec, usec);
+  return parseEpoch(p, end, sec, usec);
+}
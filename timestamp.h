@@ -0,0 +1,38 @@
+/*
+ * Parser of UTC timestamps: ISO-8601 and RFC 3339 dates and times, and
+ * seconds since the Unix epoch
+ *
+ * Works on a pointer and a length without allocating, so it can parse lines
+ * in place in a read buffer. The fixed width part of a date and time,
+ * YYYY-MM-DDTHH:MM, is checked with one vector compare where SSE2 is
+ * available.
+ */
+
+#ifndef marstimestamp
+#define marstimestamp
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Parses the timestamp in the len characters at str into UTC seconds since
+ * the Unix epoch and microseconds; blanks around it are skipped
+ * Accepts
+ *   YYYY-MM-DD[(T|t| )HH:MM[:SS[(.|,)FRACTION]][Z|z|(+|-)HH[[:]MM]]]
+ *   [@][+|-]SECONDS[.FRACTION]
+ * Times without an offset are UTC. A second of 60 is an inserted leap second
+ * and counts like the first second of the next minute; digits of a fraction
+ * past the sixth are dropped
+ * Returns 1 on success, 0 if str is not a timestamp
+ */
+int parseTimestamp(const char *str, size_t len, int64_t *sec, int32_t *usec);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,13 @@
+/*
+ * Version of the library
+ */
+
+#include "libmarstime.h"
+
+/*
+ * Returns MARSTIME_VERSION_NUMBER of the library, to check that it matches
+ * the headers a program was compiled with
+ */
+int marstimeVersion(){
+  return MARSTIME_VERSION_NUMBER;
+}
@@ -0,0 +1,126 @@
+/*
+ * Live Mars clock that updates on Martian second or minute boundaries
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+#include "watch.h"
+
+// a little over the rounding error of an MSD, in sols, so that an instant
+// computed to be on a boundary is not shown as the second before it
+#define BOUNDARY_EPS (1e-3 / 86400)
+
+/*
+ * Returns the current MSD
+ */
+static double msdNow(leapTable *table){
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return TAItoMSD(UTCstructToTAIfloat(&tv, table));
+}
+
+/*
+ * Returns the MSD at which the first step (Martian seconds) long interval
+ * of zone after MSD begins
+ */
+static double nextBoundary(double MSD, const timeZone *zone, double step){
+  double local = (MSD - zone->startsol) * 86400 + zone->offset;
+  double next = (floor(local / step) + 1) * step;
+  return (next - zone->offset) / 86400 + zone->startsol;
+}
+
+/*
+ * Arms timer to expire at the UTC instant of MSD
+ */
+static int armAt(int timer, double MSD, leapTable *table){
+  struct timeval tv;
+  MSDtoUTCstruct(MSD, table, &tv);
+  struct itimerspec it;
+  memset(&it, 0, sizeof(it));
+  it.it_value.tv_sec = tv.tv_sec;
+  it.it_value.tv_nsec = tv.tv_usec * 1000L;
+  return timerfd_settime(timer, TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET,
+      &it, NULL);
+}
+
+/*
+ * Writes the time at MSD in every zone of set
+ */
+static void showTime(double MSD, const zoneSet *set, soldate *dates,
+    int terminal){
+  static size_t lastLen = 0;
+  char line[1024];
+  size_t len = 0;
+  int i;
+  convertAllZones(MSD + BOUNDARY_EPS, set, dates);
+  for(i=0; i<set->size && len + 128 < sizeof(line); i++){
+    if(i > 0){
+      memcpy(line + len, "  ", 2);
+      len += 2;
+    }
+    int n = soldateFormat(line + len, sizeof(line) - len, &dates[i]);
+    if(n > 0)
+      len += n;
+  }
+  if(terminal){
+    // blank out what is left of a longer previous line
+    size_t end = len;
+    while(end < lastLen && end < sizeof(line))
+      line[end++] = ' ';
+    lastLen = len;
+    printf("\r%.*s", (int)end, line);
+  }
+  else
+    printf("%.*s\n", (int)len, line);
+  fflush(stdout);
+}
+
+/*
+ * Shows the current time in every zone of set on one line and rewrites it
+ * each time a Martian second (or minute if minutes is set) of the first zone
+ * begins, until interrupted
+ * Sleeps on a timerfd armed for the exact instant of the next boundary, so
+ * nothing runs between updates
+ * Writes one line per update instead if standard output is not a terminal
+ * Returns nonzero if the timer can't be set up
+ */
+int watchClock(const zoneSet *set, leapTable *table, int minutes){
+  if(set->size == 0)
+    return 1;
+  int timer = timerfd_create(CLOCK_REALTIME, TFD_CLOEXEC);
+  if(timer < 0){
+    printf("Cannot create timer\n");
+    return 1;
+  }
+  double step = minutes ? 60 : 1;
+  int terminal = isatty(1);
+  soldate dates[set->size];
+  double now = msdNow(table);
+  showTime(now, set, dates, terminal);
+  double target = nextBoundary(now, set->zones[0], step);
+  for(;;){
+    if(armAt(timer, target, table) != 0){
+      printf("Cannot set timer\n");
+      close(timer);
+      return 1;
+    }
+    uint64_t expirations;
+    ssize_t n = read(timer, &expirations, sizeof(expirations));
+    if(n < 0 && errno != ECANCELED && errno != EINTR){
+      close(timer);
+      return 1;
+    }
+    now = msdNow(table);
+    if(n < 0 || now < target){
+      // the clock was set, start over from the new time
+      showTime(now, set, dates, terminal);
+      target = nextBoundary(now, set->zones[0], step);
+      continue;
+    }
+    showTime(target, set, dates, terminal);
+    // skip boundaries missed while the process was stopped
+    target = nextBoundary(target > now ? target : now, set->zones[0], step);
+  }
+}
@@ -0,0 +1,22 @@
+/*
+ * Live Mars clock that updates on Martian second or minute boundaries
+ */
+
+#ifndef marswatch
+#define marswatch
+
+#include "leapSecs.h"
+#include "zones.h"
+
+/*
+ * Shows the current time in every zone of set on one line and rewrites it
+ * each time a Martian second (or minute if minutes is set) of the first zone
+ * begins, until interrupted
+ * Sleeps on a timerfd armed for the exact instant of the next boundary, so
+ * nothing runs between updates
+ * Writes one line per update instead if standard output is not a terminal
+ * Returns nonzero if the timer can't be set up
+ */
+int watchClock(const zoneSet *set, leapTable *table, int minutes);
+
+#endif
@@ -0,0 +1,314 @@
+/*
+ * Registry of mission time zones, looked up by epoch name
+ */
+
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "zones.h"
+#include "marsInline.h"
+
+// longest epoch or zone name read from a file, without the terminator
+#define ZONE_NAMELEN 31
+// most zones in a registry, slot indices are int16_t
+#define ZONE_MAX 4096
+// seeds tried for each table size before doubling it
+#define ZONE_SEEDS 1024
+
+static const timeZone *const builtinZones[] = {
+  &MTC, &pathfinder, &spirit, &opportunity, &phoenix, &curiosity
+};
+#define BUILTIN_SIZE ((int)(sizeof(builtinZones) / sizeof(*builtinZones)))
+
+static zoneRegistry builtin;
+static pthread_once_t builtinOnce = PTHREAD_ONCE_INIT;
+
+/*
+ * FNV-1a hash of name, started from a value that depends on seed
+ */
+static inline uint32_t zoneHash(const char *name, uint32_t seed){
+  uint32_t h = 2166136261u ^ (seed * 0x9e3779b9u);
+  while(*name != '\0'){
+    h ^= (unsigned char)*name++;
+    h *= 16777619u;
+  }
+  return h ^ (h >> 15);
+}
+
+/*
+ * Finds a seed and table size under which every epoch name of reg gets its
+ * own slot, and fills in the slots
+ * The names must be distinct
+ */
+static void buildHash(zoneRegistry *reg){
+  uint32_t nslots = 8;
+  while(nslots < 2 * (uint32_t)reg->size)
+    nslots *= 2;
+  for(;; nslots *= 2){
+    int16_t *slots = malloc(nslots * sizeof(int16_t));
+    if(slots == NULL){
+      fprintf(stderr, "Unable to alloc zone registry\n");
+      exit(1);
+    }
+    uint32_t seed;
+    for(seed=0; seed<ZONE_SEEDS; seed++){
+      memset(slots, 0xff, nslots * sizeof(int16_t));
+      int i;
+      for(i=0; i<reg->size; i++){
+        uint32_t s = zoneHash(reg->zones[i]->epochName, seed) & (nslots - 1);
+        if(slots[s] >= 0)
+          break;
+        slots[s] = i;
+      }
+      if(i == reg->size){
+        reg->seed = seed;
+        reg->mask = nslots - 1;
+        reg->slots = slots;
+        return;
+      }
+    }
+    free(slots);
+  }
+}
+
+/*
+ * Adds zone to reg, replacing a zone with the same epoch name
+ * reg->zones must have room for one more zone
+ */
+static void addZone(zoneRegistry *reg, const timeZone *zone){
+  int i;
+  for(i=0; i<reg->size; i++)
+    if(strcmp(reg->zones[i]->epochName, zone->epochName) == 0){
+      reg->zones[i] = zone;
+      return;
+    }
+  reg->zones[reg->size++] = zone;
+}
+
+/*
+ * Builds the registry of the zones compiled into marsTime.c
+ */
+static void initBuiltin(){
+  builtin.zones = malloc(BUILTIN_SIZE * sizeof(timeZone *));
+  if(builtin.zones == NULL){
+    fprintf(stderr, "Unable to alloc zone registry\n");
+    exit(1);
+  }
+  builtin.size = 0;
+  builtin.owned = NULL;
+  builtin.names = NULL;
+  int i;
+  for(i=0; i<BUILTIN_SIZE; i++)
+    addZone(&builtin, builtinZones[i]);
+  buildHash(&builtin);
+}
+
+/*
+ * Returns the registry of the built in zones, unless MARSTIME_ZONES names a
+ * config file with more zones
+ */
+const zoneRegistry* getZoneRegistry(){
+  return getZoneRegistryFile(getenv("MARSTIME_ZONES"));
+}
+
+/*
+ * Reads at most max zones in filename into owned and names, which are
+ * malloc'd to the number of zones, and returns how many there are, or -1 on
+ * error
+ */
+static int parseZones(const char *filename, timeZone **owned, char **names,
+    int max){
+  FILE *fp = fopen(filename, "r");
+  if(fp == NULL){
+    fprintf(stderr, "Cannot open file \"%s\"\n", filename);
+    return -1;
+  }
+  const size_t namesLen = 2 * (ZONE_NAMELEN + 1);
+  timeZone *zones = NULL;
+  char *text = NULL;
+  int size = 0, room = 0;
+  int line = 0;
+  char buffer[256];
+  while(fgets(buffer, sizeof(buffer), fp) != NULL){
+    line++;
+    char *p = buffer + strspn(buffer, " \t");
+    if(*p == '#' || *p == '\n' || *p == '\r' || *p == '\0')
+      continue;
+    if(size == max){
+      fprintf(stderr, "Too many zones in \"%s\"\n", filename);
+      size = -1;
+      break;
+    }
+    if(size == room){
+      room = room == 0 ? 16 : 2 * room;
+      if(room > max)
+        room = max;
+      zones = realloc(zones, room * sizeof(timeZone));
+      text = realloc(text, room * namesLen);
+      if(zones == NULL || text == NULL){
+        fprintf(stderr, "Unable to alloc zone registry\n");
+        exit(1);
+      }
+    }
+    timeZone *zone = &zones[size];
+    char *epoch = text + size * namesLen;
+    char *name = epoch + ZONE_NAMELEN + 1;
+    name[0] = '\0';
+    int n = sscanf(p, "%31s %ld %lf %d %31s", epoch, &zone->startsol,
+        &zone->offset, &zone->digits, name);
+    if(n < 4 || zone->digits < 0 || zone->digits > 20){
+      fprintf(stderr, "Bad zone on line %d of \"%s\"\n", line, filename);
+      size = -1;
+      break;
+    }
+    size++;
+  }
+  fclose(fp);
+  if(size <= 0){
+    free(zones);
+    free(text);
+    return size;
+  }
+  // shrink to the zones read, then point them at their names
+  *owned = realloc(zones, size * sizeof(timeZone));
+  *names = realloc(text, size * namesLen);
+  if(*owned == NULL || *names == NULL){
+    fprintf(stderr, "Unable to alloc zone registry\n");
+    exit(1);
+  }
+  int i;
+  for(i=0; i<size; i++){
+    (*owned)[i].epochName = *names + i * namesLen;
+    (*owned)[i].zoneName = *names + i * namesLen + ZONE_NAMELEN + 1;
+  }
+  return size;
+}
+
+/*
+ * Returns the registry of the built in zones, or one that also holds the
+ * zones in filename
+ * filename may be NULL or empty to skip the file
+ * Each non-comment line of the file defines one zone:
+ *   EPOCH STARTSOL OFFSET DIGITS [ZONE]
+ * e.g. "MSL 49269 32981.736 4", where OFFSET is in martian seconds ahead of
+ * MTC and ZONE is the optional name shown after the time
+ * A zone with the same epoch name as a built in one replaces it
+ * A registry read from a file is released with zoneRegistryFree
+ */
+const zoneRegistry* getZoneRegistryFile(const char *filename){
+  pthread_once(&builtinOnce, initBuiltin);
+  if(filename == NULL || filename[0] == '\0')
+    return &builtin;
+
+  timeZone *owned;
+  char *names;
+  int size = parseZones(filename, &owned, &names, ZONE_MAX - BUILTIN_SIZE);
+  if(size <= 0)
+    return &builtin;
+  zoneRegistry *reg = malloc(sizeof(zoneRegistry));
+  if(reg == NULL){
+    fprintf(stderr, "Unable to alloc zone registry\n");
+    exit(1);
+  }
+  reg->zones = malloc((BUILTIN_SIZE + size) * sizeof(timeZone *));
+  if(reg->zones == NULL){
+    fprintf(stderr, "Unable to alloc zone registry\n");
+    exit(1);
+  }
+  reg->size = 0;
+  reg->owned = owned;
+  reg->names = names;
+  int i;
+  for(i=0; i<BUILTIN_SIZE; i++)
+    addZone(reg, builtinZones[i]);
+  for(i=0; i<size; i++)
+    addZone(reg, &owned[i]);
+  buildHash(reg);
+  return reg;
+}
+
+/*
+ * Releases a registry returned by getZoneRegistryFile or getZoneRegistry
+ * The registry of the built in zones is kept, so any of them may be passed
+ */
+void zoneRegistryFree(const zoneRegistry *reg){
+  if(reg == NULL || reg == &builtin)
+    return;
+  zoneRegistry *r = (zoneRegistry *)reg;
+  free(r->zones);
+  free(r->slots);
+  free(r->owned);
+  free(r->names);
+  free(r);
+}
+
+/*
+ * Returns the zone with the given epoch name (case sensitive, e.g. "MSL"),
+ * or NULL if there is none
+ */
+const timeZone* findZone(const zoneRegistry *reg, const char *name){
+  int i = reg->slots[zoneHash(name, reg->seed) & reg->mask];
+  if(i < 0 || strcmp(reg->zones[i]->epochName, name) != 0)
+    return NULL;
+  return reg->zones[i];
+}
+
+/*
+ * Returns a set holding every zone of reg, in the order they were added
+ */
+zoneSet* makeZoneSet(const zoneRegistry *reg){
+  zoneSet *set = malloc(sizeof(zoneSet));
+  if(set == NULL){
+    fprintf(stderr, "Unable to alloc zone set\n");
+    exit(1);
+  }
+  set->size = reg->size;
+  set->zones = malloc(reg->size * sizeof(timeZone *));
+  set->startsol = malloc(reg->size * sizeof(long));
+  set->offset = malloc(reg->size * sizeof(double));
+  if(set->zones == NULL || set->startsol == NULL || set->offset == NULL){
+    fprintf(stderr, "Unable to alloc zone set\n");
+    exit(1);
+  }
+  int i;
+  for(i=0; i<reg->size; i++){
+    set->zones[i] = reg->zones[i];
+    set->startsol[i] = reg->zones[i]->startsol;
+    set->offset[i] = reg->zones[i]->offset / 86400;
+  }
+  return set;
+}
+
+/*
+ * Releases a set returned by makeZoneSet
+ */
+void freeZoneSet(zoneSet *set){
+  if(set == NULL)
+    return;
+  free(set->zones);
+  free(set->startsol);
+  free(set->offset);
+  free(set);
+}
+
+/*
+ * Converts MSD to a sol date in each zone of set, out has room for set->size
+ * dates
+ * Gives the same dates as MSDtoSoldate_r for each zone through splitSol,
+ * but splits MSD into sol and fraction only once
+ */
+void convertAllZones(double MSD, const zoneSet *set, soldate *out){
+  double whole = floor(MSD);
+  long sol = whole;
+  double frac = MSD - whole;
+  int i;
+  for(i=0; i<set->size; i++){
+    int secs;
+    long carry = splitSol_inline(frac, set->offset[i], &secs);
+    out[i].sol = sol + carry - set->startsol[i];
+    out[i].hour = secs / 3600;
+    out[i].min = secs / 60 % 60;
+    out[i].sec = secs % 60;
+    out[i].tz = set->zones[i];
+  }
+}
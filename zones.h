@@ -0,0 +1,97 @@
+/*
+ * Registry of mission time zones, looked up by epoch name
+ *
+ * The zones compiled into marsTime.c are always present; a config file can
+ * add zones or replace them by name. Each registry gets a perfect hash of
+ * its epoch names when it is built, so a lookup is one hash, one slot load
+ * and one string compare. A registry is never changed after it is built and
+ * can be shared between threads without locking.
+ */
+
+#ifndef marszones
+#define marszones
+
+#include <stdint.h>
+#include "marsTime.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Set of time zones with a perfect hash of their epoch names
+ */
+typedef struct{
+  int size; // number of zones
+  const timeZone **zones; // the zones, in the order they were added
+  uint32_t seed; // hash seed under which no two names share a slot
+  uint32_t mask; // number of slots - 1, a power of two - 1
+  int16_t *slots; // index into zones for each slot, -1 if empty
+  timeZone *owned; // zones read from a config file
+  char *names; // epoch and zone names of the zones read from a file
+} zoneRegistry;
+
+/*
+ * Zones laid out for converting one instant to all of them at once
+ */
+typedef struct{
+  int size; // number of zones
+  const timeZone **zones;
+  long *startsol; // startsol of each zone
+  double *offset; // offset of each zone in sols ahead of MTC
+} zoneSet;
+
+/*
+ * Returns the registry of the built in zones, unless MARSTIME_ZONES names a
+ * config file with more zones
+ */
+const zoneRegistry* getZoneRegistry();
+
+/*
+ * Returns the registry of the built in zones, or one that also holds the
+ * zones in filename
+ * filename may be NULL or empty to skip the file
+ * Each non-comment line of the file defines one zone:
+ *   EPOCH STARTSOL OFFSET DIGITS [ZONE]
+ * e.g. "MSL 49269 32981.736 4", where OFFSET is in martian seconds ahead of
+ * MTC and ZONE is the optional name shown after the time
+ * A zone with the same epoch name as a built in one replaces it
+ * A registry read from a file is released with zoneRegistryFree
+ */
+const zoneRegistry* getZoneRegistryFile(const char *filename);
+
+/*
+ * Releases a registry returned by getZoneRegistryFile or getZoneRegistry
+ * The registry of the built in zones is kept, so any of them may be passed
+ */
+void zoneRegistryFree(const zoneRegistry *reg);
+
+/*
+ * Returns the zone with the given epoch name (case sensitive, e.g. "MSL"),
+ * or NULL if there is none
+ */
+const timeZone* findZone(const zoneRegistry *reg, const char *name);
+
+/*
+ * Returns a set holding every zone of reg, in the order they were added
+ */
+zoneSet* makeZoneSet(const zoneRegistry *reg);
+
+/*
+ * Releases a set returned by makeZoneSet
+ */
+void freeZoneSet(zoneSet *set);
+
+/*
+ * Converts MSD to a sol date in each zone of set, out has room for set->size
+ * dates
+ * Gives the same dates as MSDtoSoldate_r for each zone through splitSol,
+ * but splits MSD into sol and fraction only once
+ */
+void convertAllZones(double MSD, const zoneSet *set, soldate *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif